@@ -1,27 +1,27 @@
-#ifndef ABOUT_H
-#define ABOUT_H
-
-#include <QDialog>
-#include <QDesktopServices>
-#include <QUrl>
-
-namespace Ui {
-class about;
-}
-
-class about : public QDialog
-{
-    Q_OBJECT
-
-public:
-    explicit about(QWidget *parent = 0);
-    ~about();
-
-private:
-    Ui::about *ui;
-
-private slots:
-    void url();
-};
-
-#endif // ABOUT_H
+#ifndef ABOUT_H
+#define ABOUT_H
+
+#include <QDialog>
+#include <QDesktopServices>
+#include <QUrl>
+
+namespace Ui {
+class about;
+}
+
+class about : public QDialog
+{
+    Q_OBJECT
+
+public:
+    explicit about(QWidget *parent = 0);
+    ~about();
+
+private:
+    Ui::about *ui;
+
+private slots:
+    void url();
+};
+
+#endif // ABOUT_H
@@ -0,0 +1,342 @@
+#include "bandio.h"
+#include <QFileInfo>
+#include <QByteArray>
+#include <cstring>
+#include <png.h>
+
+// Next whitespace separated token of a netpbm header, skipping comments
+
+static QByteArray headerToken(QFile &file)
+{
+    QByteArray token;
+    char c;
+    while (file.getChar(&c))
+    {
+        if (c == '#')
+        {
+            while (file.getChar(&c) && c != '\n') ;
+            continue;
+        }
+        if (c == ' ' || c == '\t' || c == '\r' || c == '\n')
+        {
+            if (!token.isEmpty()) break;
+            continue;
+        }
+        token.append(c);
+    }
+    return token;
+}
+
+// libpng reads and writes through the QFile, its errors longjmp back into
+// the caller's setjmp and warnings are dropped
+
+static void readPngData(png_structp png, png_bytep data, png_size_t length)
+{
+    QFile *file = static_cast<QFile*>(png_get_io_ptr(png));
+    if (file->read(reinterpret_cast<char*>(data), length) != (qint64)length)
+        png_error(png, "truncated file");
+}
+
+static void writePngData(png_structp png, png_bytep data, png_size_t length)
+{
+    QFile *file = static_cast<QFile*>(png_get_io_ptr(png));
+    if (file->write(reinterpret_cast<const char*>(data), length) != (qint64)length)
+        png_error(png, "write failed");
+}
+
+static void flushPngData(png_structp) {}
+static void ignorePngWarning(png_structp, png_const_charp) {}
+
+static bool hasSuffix(const QString &path, const char *a, const char *b, const char *c)
+{
+    QString suffix = QFileInfo(path).suffix().toLower();
+    return suffix == QString(a) || suffix == QString(b) || suffix == QString(c);
+}
+
+BandReader::BandReader() :
+    _data(-1), _width(0), _height(0), _depth(0), _alpha(false),
+    _png(NULL), _info(NULL), _next(0), _bandFrom(0) {}
+
+BandReader::~BandReader() {closePng();}
+
+bool BandReader::canStream(const QString &path) {return hasSuffix(path, "png", "ppm", "pam");}
+
+bool BandReader::open(const QString &path)
+{
+    closePng();
+    _data = -1;
+    _band = QImage();
+
+    _file.close();
+    _file.setFileName(path);
+    if (!_file.open(QIODevice::ReadOnly)) return false;
+    if (openNetpbm()) return true;
+    return _file.seek(0) && openPng();
+}
+
+bool BandReader::openNetpbm()
+{
+    QByteArray magic = headerToken(_file);
+    int maxval = 0;
+    bool ok = true;
+
+    if (magic == "P6")
+    {
+        _width = headerToken(_file).toInt(&ok);
+        if (ok) _height = headerToken(_file).toInt(&ok);
+        if (ok) maxval = headerToken(_file).toInt(&ok);
+        _depth = 3;
+    }
+    else if (magic == "P7")
+    {
+        QByteArray key, type;
+        _depth = 0;
+        while (ok && (key = headerToken(_file)) != "ENDHDR")
+        {
+            if (key.isEmpty()) return false;
+            if (key == "TUPLTYPE") type = headerToken(_file);
+            else if (key == "WIDTH") _width = headerToken(_file).toInt(&ok);
+            else if (key == "HEIGHT") _height = headerToken(_file).toInt(&ok);
+            else if (key == "DEPTH") _depth = headerToken(_file).toInt(&ok);
+            else if (key == "MAXVAL") maxval = headerToken(_file).toInt(&ok);
+            else headerToken(_file);
+        }
+        if (type != "RGB" && type != "RGB_ALPHA") return false;
+    }
+    else
+        return false;
+
+    if (!ok || maxval != 255 || _width <= 0 || _height <= 0 || (_depth != 3 && _depth != 4))
+        return false;
+    _alpha = _depth == 4;
+    _data = _file.pos();
+    return true;
+}
+
+// Starts decoding at the first row. Every PNG is expanded to 8-bit RGB or
+// RGBA rows; interlaced ones need the whole image and are refused.
+
+bool BandReader::openPng()
+{
+    png_byte signature[8];
+    if (_file.read(reinterpret_cast<char*>(signature), 8) != 8 || png_sig_cmp(signature, 0, 8))
+        return false;
+
+    _png = png_create_read_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, ignorePngWarning);
+    if (_png) _info = png_create_info_struct(_png);
+    if (!_info) return false;
+    if (setjmp(png_jmpbuf(_png))) return false;
+
+    png_set_read_fn(_png, &_file, readPngData);
+    png_set_sig_bytes(_png, 8);
+    png_read_info(_png, _info);
+    if (png_get_interlace_type(_png, _info) != PNG_INTERLACE_NONE) return false;
+    png_set_expand(_png);
+    png_set_scale_16(_png);
+    png_set_gray_to_rgb(_png);
+    png_read_update_info(_png, _info);
+
+    _width = png_get_image_width(_png, _info);
+    _height = png_get_image_height(_png, _info);
+    _depth = png_get_channels(_png, _info);
+    _alpha = _depth == 4;
+    _row.resize(png_get_rowbytes(_png, _info));
+    _next = 0;
+    return _width > 0 && _height > 0 && (_depth == 3 || _depth == 4);
+}
+
+// setjmp() is kept out of functions with live locals, a longjmp leaves
+// them indeterminate
+
+bool BandReader::decodePngRow()
+{
+    if (setjmp(png_jmpbuf(_png))) return false;
+    png_read_row(_png, _row.data(), NULL);
+    _next++;
+    return true;
+}
+
+bool BandReader::readPngRow(QRgb *line)
+{
+    if (!decodePngRow()) return false;
+    const uchar *row = _row.constData();
+    for (int y = 0; y < _width; y++, row += _depth)
+        line[y] = qRgba(row[0], row[1], row[2], _depth == 4 ? row[3] : 0xff);
+    return true;
+}
+
+void BandReader::closePng()
+{
+    if (_png) png_destroy_read_struct(&_png, _info ? &_info : NULL, NULL);
+    _png = NULL;
+    _info = NULL;
+}
+
+// Rows [from, from + count) as a 32-bit image, ARGB32 when the source has
+// alpha and RGB32 otherwise
+
+QImage BandReader::read(int from, int count)
+{
+    QImage::Format format = _alpha ? QImage::Format_ARGB32 : QImage::Format_RGB32;
+    if (from < 0 || count <= 0 || from + count > _height) return QImage();
+    QImage band(_width, count, format);
+
+    if (_data < 0)
+    {
+        if (!_png) return QImage();
+
+        // rows up to `cached` come from the last band, the others are decoded
+        // unless the decoder is already past them
+        int cached = from >= _bandFrom ? _bandFrom + _band.height() : from;
+        if (qMax(from, cached) < qMin(from + count, _next))
+        {
+            closePng();
+            _band = QImage();
+            cached = from;
+            if (!_file.seek(0) || !openPng()) return QImage();
+        }
+        QVector<QRgb> skipped(_width);
+        for (int x = 0; x < count; x++)
+        {
+            int row = from + x;
+            QRgb *line = reinterpret_cast<QRgb*>(band.scanLine(x));
+            if (row < cached)
+            {
+                memcpy(line, _band.constScanLine(row - _bandFrom), _width * sizeof(QRgb));
+                continue;
+            }
+            while (_next < row) if (!readPngRow(skipped.data())) return QImage();
+            if (!readPngRow(line)) return QImage();
+        }
+        _band = band;
+        _bandFrom = from;
+        return band;
+    }
+
+    QVector<uchar> row(_width * _depth);
+    if (!_file.seek(_data + (qint64)from * _width * _depth)) return QImage();
+    for (int x = 0; x < count; x++)
+    {
+        if (_file.read(reinterpret_cast<char*>(row.data()), row.size()) != row.size())
+            return QImage();
+        QRgb *line = reinterpret_cast<QRgb*>(band.scanLine(x));
+        const uchar *p = row.constData();
+        for (int y = 0; y < _width; y++, p += _depth)
+            line[y] = qRgba(p[0], p[1], p[2], _depth == 4 ? p[3] : 0xff);
+    }
+    return band;
+}
+
+BandWriter::BandWriter() : _width(0), _height(0), _depth(0), _png(NULL), _info(NULL), _row(0) {}
+
+BandWriter::~BandWriter() {closePng();}
+
+bool BandWriter::canStream(const QString &path) {return hasSuffix(path, "png", "ppm", "pam");}
+
+// .ppm files get P6 (alpha dropped), .pam files P7, .png files an 8-bit RGB
+// or RGBA PNG
+
+bool BandWriter::open(const QString &path, int width, int height, bool alpha)
+{
+    QString suffix = QFileInfo(path).suffix().toLower();
+    closePng();
+    _width = width;
+    _height = height;
+    _row = 0;
+    if (!canStream(path)) return false;
+
+    _file.close();
+    _file.setFileName(path);
+    if (!_file.open(QIODevice::WriteOnly)) return false;
+    if (suffix == QString("png")) return openPng(alpha);
+
+    QByteArray header;
+    if (suffix == QString("ppm") || !alpha)
+        _depth = 3;
+    else
+        _depth = 4;
+    if (suffix == QString("ppm"))
+        header = "P6\n" + QByteArray::number(width) + ' ' + QByteArray::number(height) + "\n255\n";
+    else
+        header = "P7\nWIDTH " + QByteArray::number(width) + "\nHEIGHT " + QByteArray::number(height) +
+                 "\nDEPTH " + QByteArray::number(_depth) + "\nMAXVAL 255\nTUPLTYPE " +
+                 (_depth == 4 ? "RGB_ALPHA" : "RGB") + "\nENDHDR\n";
+    return _file.write(header) == header.size();
+}
+
+bool BandWriter::openPng(bool alpha)
+{
+    _depth = alpha ? 4 : 3;
+    _png = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, ignorePngWarning);
+    if (_png) _info = png_create_info_struct(_png);
+    if (!_info) return false;
+    if (setjmp(png_jmpbuf(_png))) return false;
+
+    png_set_write_fn(_png, &_file, writePngData, flushPngData);
+    png_set_IHDR(_png, _info, _width, _height, 8,
+                 alpha ? PNG_COLOR_TYPE_RGB_ALPHA : PNG_COLOR_TYPE_RGB,
+                 PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_DEFAULT, PNG_FILTER_TYPE_DEFAULT);
+    png_write_info(_png, _info);
+    return true;
+}
+
+bool BandWriter::writePngRow(const uchar *row)
+{
+    if (setjmp(png_jmpbuf(_png))) return false;
+    png_write_row(_png, row);
+    return true;
+}
+
+void BandWriter::closePng()
+{
+    if (_png) png_destroy_write_struct(&_png, _info ? &_info : NULL);
+    _png = NULL;
+    _info = NULL;
+}
+
+// Appends rows [from, from + count) of `band`, bands must come top to bottom
+
+bool BandWriter::write(const QImage &band, int from, int count)
+{
+    if (_row + count > _height) return false;
+
+    QVector<uchar> row(_width * _depth);
+    for (int x = 0; x < count; x++)
+    {
+        const QRgb *line = reinterpret_cast<const QRgb*>(band.constScanLine(from + x));
+        uchar *p = row.data();
+        for (int y = 0; y < _width; y++, p += _depth)
+        {
+            p[0] = qRed(line[y]);
+            p[1] = qGreen(line[y]);
+            p[2] = qBlue(line[y]);
+            if (_depth == 4) p[3] = qAlpha(line[y]);
+        }
+        if (_png)
+        {
+            if (!writePngRow(row.constData())) return false;
+        }
+        else if (_file.write(reinterpret_cast<const char*>(row.constData()), row.size()) != row.size())
+            return false;
+    }
+    _row += count;
+    return true;
+}
+
+bool BandWriter::endPng()
+{
+    if (setjmp(png_jmpbuf(_png))) return false;
+    png_write_end(_png, NULL);
+    return true;
+}
+
+// A PNG is only complete once every row has been written
+
+bool BandWriter::close()
+{
+    bool ok = _row == _height;
+    if (_png && ok) ok = endPng();
+    closePng();
+    _file.close();
+    return ok;
+}
@@ -0,0 +1,80 @@
+#ifndef BANDIO_H
+#define BANDIO_H
+
+#include <QtGui/QImage>
+#include <QFile>
+#include <QString>
+#include <QVector>
+
+struct png_struct_def;
+struct png_info_def;
+
+// Row band access to image files for the streaming rasterizer, memory stays
+// proportional to the band whatever the image size.
+//
+// Binary netpbm files (P6, and P7 with an RGB or RGB_ALPHA tuple type) with
+// a maxval of 255 are read and written a band at a time straight from the
+// file. Non-interlaced PNG files go through libpng's row interface: rows are
+// decoded top to bottom, the overlap with the previous band is reused and
+// reading back above it restarts the decoder. Other formats can't be
+// streamed and fail to open.
+
+class BandReader
+{
+public:
+    BandReader();
+    ~BandReader();
+    bool open(const QString &path);
+    QImage read(int from, int count);
+    static bool canStream(const QString &path);
+
+    inline int width() const {return _width;}
+    inline int height() const {return _height;}
+    inline bool hasAlpha() const {return _alpha;}
+
+private:
+    Q_DISABLE_COPY(BandReader)
+    bool openNetpbm();
+    bool openPng();
+    bool decodePngRow();
+    bool readPngRow(QRgb *line);
+    void closePng();
+
+    QFile _file;
+    qint64 _data;           // offset of the first netpbm row, -1 otherwise
+    int _width, _height, _depth;
+    bool _alpha;
+
+    png_struct_def *_png;
+    png_info_def *_info;
+    QVector<uchar> _row;
+    int _next;              // next PNG row to decode
+    QImage _band;           // last band read and its first row
+    int _bandFrom;
+};
+
+class BandWriter
+{
+public:
+    BandWriter();
+    ~BandWriter();
+    bool open(const QString &path, int width, int height, bool alpha);
+    bool write(const QImage &band, int from, int count);
+    bool close();
+    static bool canStream(const QString &path);
+
+private:
+    Q_DISABLE_COPY(BandWriter)
+    bool openPng(bool alpha);
+    bool writePngRow(const uchar *row);
+    bool endPng();
+    void closePng();
+
+    QFile _file;
+    int _width, _height, _depth;
+    png_struct_def *_png;
+    png_info_def *_info;
+    int _row;
+};
+
+#endif // BANDIO_H
@@ -0,0 +1,20 @@
+#-------------------------------------------------
+#
+# Headless batch rasterizer
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = eciser_batch
+TEMPLATE = app
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+include(../rasterhandler.pri)
+
+SOURCES += main.cpp \
+    batchjob.cpp
+
+HEADERS  += batchjob.h
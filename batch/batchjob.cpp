@@ -0,0 +1,100 @@
+#include "batchjob.h"
+#include <QElapsedTimer>
+#include <QImageReader>
+#include <QFileInfo>
+#include <QDir>
+
+BatchJob::BatchJob(const BatchSettings &settings, BatchResult *result,
+                   QTextStream *log, QMutex *logLock) :
+    _settings(settings), _result(result), _log(log), _logLock(logLock)
+{
+    setAutoDelete(true);
+}
+
+void BatchJob::run()
+{
+    QElapsedTimer timer;
+    RasterHandler r(_settings.window, _settings.cthres, _settings.sdiam, _settings.fcthres);
+    r.setThreadCount(_settings.threads);
+    r.setTrace(_settings.trace);
+    if (_settings.trace) _settings.trace->begin("job", -1, _result->input);
+
+    _result->ok = false;
+    _result->loadTime = _result->rasterTime = _result->saveTime = 0;
+    _result->cacheHits = _result->cacheMisses = 0;
+
+    // streamed files are read, rastered and written band by band, which is
+    // all counted as raster time
+    if (_settings.stream)
+    {
+        if (!BandReader::canStream(_result->input) || !BandWriter::canStream(_result->output))
+        {
+            _result->error = QString("only PNG and binary netpbm files can be streamed");
+            traceEnd(_settings.trace, "job");
+            log();
+            return;
+        }
+        timer.start();
+        QDir().mkpath(QFileInfo(_result->output).absolutePath());
+        _result->ok = r.rasterStream(_result->input, _result->output);
+        _result->rasterTime = timer.elapsed();
+        _result->cacheHits = r.getCacheHits();
+        _result->cacheMisses = r.getCacheMisses();
+        _result->stats = r.getStats();
+        if (!_result->ok)
+            _result->error = QString("streaming failed");
+        traceEnd(_settings.trace, "job");
+        log();
+        return;
+    }
+
+    // load
+    timer.start();
+    r.setOriginal(_result->input);
+    _result->loadTime = timer.elapsed();
+    if (!r.isLoaded())
+    {
+        QSize size = QImageReader(_result->input).size();
+        if ((qint64)size.width() * size.height() > MAX_IMAGE_PIXELS)
+            _result->error = QString("image too large, rasterize it with --stream");
+        else
+            _result->error = QString("can't process this image");
+    }
+
+    // raster
+    if (_result->error.isEmpty())
+    {
+        timer.restart();
+        r.raster();
+        _result->rasterTime = timer.elapsed();
+        _result->cacheHits = r.getCacheHits();
+        _result->cacheMisses = r.getCacheMisses();
+        if (!r.isRastered())
+            _result->error = QString("rasterization failed");
+    }
+
+    // save
+    if (_result->error.isEmpty())
+    {
+        timer.restart();
+        QDir().mkpath(QFileInfo(_result->output).absolutePath());
+        if (r.saveRastered(_result->output))
+            _result->ok = true;
+        else
+            _result->error = QString("can't save to this file");
+        _result->saveTime = timer.elapsed();
+    }
+    _result->stats = r.getStats();
+    traceEnd(_settings.trace, "job");
+    log();
+}
+
+void BatchJob::log()
+{
+    QMutexLocker locker(_logLock);
+    if (_result->ok)
+        *_log << _result->input << " -> " << _result->output << " ("
+              << _result->loadTime + _result->rasterTime + _result->saveTime << " ms)" << endl;
+    else
+        *_log << _result->input << ": " << _result->error << endl;
+}
@@ -0,0 +1,45 @@
+#ifndef BATCHJOB_H
+#define BATCHJOB_H
+
+#include <QRunnable>
+#include <QString>
+#include <QMutex>
+#include <QTextStream>
+#include "rasterhandler.h"
+
+struct BatchSettings
+{
+    int window, sdiam, threads;
+    double cthres, fcthres;
+    bool stream;
+    TraceRecorder *trace;       // shared by every job, NULL unless tracing
+};
+
+struct BatchResult
+{
+    QString input, output;
+    bool ok;
+    QString error;
+    qint64 loadTime, rasterTime, saveTime;
+    qint64 cacheHits, cacheMisses;
+    RasterStats stats;
+};
+
+class BatchJob : public QRunnable
+{
+public:
+    BatchJob(const BatchSettings &, BatchResult *, QTextStream *, QMutex *);
+    void run();
+
+private:
+    void log();
+
+    BatchSettings _settings;
+    BatchResult *_result;
+
+    // per-file progress lines are shared between workers
+    QTextStream *_log;
+    QMutex *_logLock;
+};
+
+#endif // BATCHJOB_H
@@ -0,0 +1,248 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QThreadPool>
+#include <QElapsedTimer>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QDir>
+#include <QFile>
+#include <QVector>
+#include <QHash>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include "batchjob.h"
+
+static const char *imageFilters[] = {"*.png", "*.bmp", "*.jpg", "*.ppm", "*.pam"};
+
+// Expands the command line inputs into (input, output) pairs. Directories
+// are scanned for images and keep their layout below the output directory,
+// "@list" arguments name a text file with one input path per line.
+
+static void collectInputs(const QString &arg, const QDir &outDir, bool recursive,
+                          QVector<BatchResult> &jobs, QTextStream &err)
+{
+    if (arg.startsWith(QString("@")))
+    {
+        QFile list(arg.mid(1));
+        if (!list.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            err << "Can't read list file " << list.fileName() << endl;
+            return;
+        }
+        QTextStream in(&list);
+        while (!in.atEnd())
+        {
+            QString line = in.readLine().trimmed();
+            if (!line.isEmpty()) collectInputs(line, outDir, recursive, jobs, err);
+        }
+        return;
+    }
+
+    QFileInfo info(arg);
+    BatchResult job;
+    job.ok = false;
+    job.loadTime = job.rasterTime = job.saveTime = 0;
+    job.cacheHits = job.cacheMisses = 0;
+
+    if (info.isDir())
+    {
+        QDir base(arg);
+        QStringList filters;
+        for (unsigned i = 0; i < sizeof(imageFilters) / sizeof(*imageFilters); i++)
+            filters << QString(imageFilters[i]);
+        QDirIterator it(arg, filters, QDir::Files,
+                        recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+        QStringList found;
+        while (it.hasNext()) found << it.next();
+        found.sort();
+        for (int i = 0; i < found.size(); i++)
+        {
+            job.input = found.at(i);
+            job.output = outDir.filePath(base.relativeFilePath(found.at(i)));
+            jobs.append(job);
+        }
+    }
+    else if (info.isFile())
+    {
+        job.input = arg;
+        job.output = outDir.filePath(info.fileName());
+        jobs.append(job);
+    }
+    else
+        err << "No such file or directory: " << arg << endl;
+}
+
+int main(int argc, char *argv[])
+{
+    // only used for argument handling and image plugin lookup, the event
+    // loop is never entered
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("eciser_batch");
+
+    QTextStream out(stdout), err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Rasterizes images without the GUI, one file per worker thread.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("inputs", "Image files, directories or @list files.", "inputs...");
+
+    QCommandLineOption windowOption(QStringList() << "w" << "window",
+                                    "Shape color window size.", "size",
+                                    QString::number(DEFAULT_WINDOW));
+    QCommandLineOption cthresOption(QStringList() << "t" << "color-threshold",
+                                    "Shape color threshold.", "value",
+                                    QString::number(DEFAULT_COLOR_THRESHOLD));
+    QCommandLineOption fcthresOption(QStringList() << "f" << "fitting-threshold",
+                                     "Fitting color threshold.", "value",
+                                     QString::number(DEFAULT_FITTING_COLOR_THRESHOLD));
+    QCommandLineOption sdiamOption(QStringList() << "d" << "search-diameter",
+                                   "Search diameter.", "size",
+                                   QString::number(DEFAULT_SEARCH_DIAMETER));
+    QCommandLineOption outputOption(QStringList() << "o" << "output",
+                                    "Output directory.", "dir", "rastered");
+    QCommandLineOption jobsOption(QStringList() << "j" << "jobs",
+                                  "Number of worker threads.", "count",
+                                  QString::number(QThread::idealThreadCount()));
+    QCommandLineOption threadsOption(QStringList() << "p" << "threads-per-job",
+                                     "Threads used inside each job.", "count", "1");
+    QCommandLineOption summaryOption(QStringList() << "s" << "summary",
+                                     "Write the per-file timing summary to this file.", "file");
+    QCommandLineOption statsOption("stats",
+                                   "Write the per-file stage timings and counts as JSON to this file.",
+                                   "file");
+    QCommandLineOption traceOption("trace",
+                                   "Write a Chrome trace of every stage, band and worker to this file.",
+                                   "file");
+    QCommandLineOption recursiveOption(QStringList() << "r" << "recursive",
+                                       "Descend into subdirectories.");
+    QCommandLineOption streamOption("stream",
+                                    "Process images band by band instead of loading them whole. "
+                                    "Only .png and binary .ppm/.pam files can be streamed.");
+    parser.addOption(windowOption);
+    parser.addOption(cthresOption);
+    parser.addOption(fcthresOption);
+    parser.addOption(sdiamOption);
+    parser.addOption(outputOption);
+    parser.addOption(jobsOption);
+    parser.addOption(threadsOption);
+    parser.addOption(summaryOption);
+    parser.addOption(statsOption);
+    parser.addOption(traceOption);
+    parser.addOption(recursiveOption);
+    parser.addOption(streamOption);
+    parser.process(a);
+
+    BatchSettings settings;
+    bool ok[6];
+    settings.window = parser.value(windowOption).toInt(&ok[0]);
+    settings.cthres = parser.value(cthresOption).toDouble(&ok[1]);
+    settings.fcthres = parser.value(fcthresOption).toDouble(&ok[2]);
+    settings.sdiam = parser.value(sdiamOption).toInt(&ok[3]);
+    settings.threads = parser.value(threadsOption).toInt(&ok[5]);
+    settings.stream = parser.isSet(streamOption);
+    TraceRecorder trace;
+    settings.trace = parser.isSet(traceOption) ? &trace : NULL;
+    int threads = parser.value(jobsOption).toInt(&ok[4]);
+    if (!ok[0] || !ok[1] || !ok[2] || !ok[3] || !ok[4] || !ok[5] ||
+            settings.window < 1 || settings.sdiam < 1 || threads < 1 || settings.threads < 1)
+    {
+        err << "Invalid parameter." << endl;
+        return 1;
+    }
+
+    QDir outDir(parser.value(outputOption));
+    QVector<BatchResult> results;
+    QStringList inputs = parser.positionalArguments();
+    for (int i = 0; i < inputs.size(); i++)
+        collectInputs(inputs.at(i), outDir, parser.isSet(recursiveOption), results, err);
+    if (results.isEmpty())
+    {
+        err << "Nothing to do." << endl;
+        return 1;
+    }
+
+    // jobs run concurrently, two inputs writing one file would race
+    QHash<QString, int> outputs;
+    for (int i = 0; i < results.size(); i++)
+    {
+        QString output = QFileInfo(results.at(i).output).absoluteFilePath();
+        int other = outputs.value(output, -1);
+        if (other >= 0)
+        {
+            err << results.at(other).input << " and " << results.at(i).input
+                << " would both be written to " << results.at(i).output << endl;
+            return 1;
+        }
+        outputs.insert(output, i);
+    }
+
+    // one RasterHandler per job, the pool keeps every core busy
+    QElapsedTimer wall;
+    QMutex logLock;
+    QThreadPool pool;
+    pool.setMaxThreadCount(threads);
+    wall.start();
+    for (int i = 0; i < results.size(); i++)
+        pool.start(new BatchJob(settings, &results[i], &err, &logLock));
+    pool.waitForDone();
+    qint64 wallTime = wall.elapsed();
+
+    if (settings.trace && !trace.save(parser.value(traceOption)))
+    {
+        err << "Can't write trace to " << parser.value(traceOption) << endl;
+        return 1;
+    }
+
+    // timing summary
+    QFile summaryFile;
+    QTextStream summaryStream;
+    QTextStream *summary = &out;
+    if (parser.isSet(summaryOption))
+    {
+        summaryFile.setFileName(parser.value(summaryOption));
+        if (!summaryFile.open(QIODevice::WriteOnly | QIODevice::Text))
+        {
+            err << "Can't write summary to " << summaryFile.fileName() << endl;
+            return 1;
+        }
+        summaryStream.setDevice(&summaryFile);
+        summary = &summaryStream;
+    }
+
+    int failed = 0;
+    qint64 cpuTime = 0;
+    *summary << "file\tload_ms\traster_ms\tsave_ms\tcache_hits\tcache_misses\tstatus" << endl;
+    for (int i = 0; i < results.size(); i++)
+    {
+        const BatchResult &r = results.at(i);
+        *summary << r.input << '\t' << r.loadTime << '\t' << r.rasterTime << '\t'
+                << r.saveTime << '\t' << r.cacheHits << '\t' << r.cacheMisses << '\t'
+                << (r.ok ? QString("ok") : r.error) << endl;
+        cpuTime += r.loadTime + r.rasterTime + r.saveTime;
+        if (!r.ok) failed++;
+    }
+
+    if (parser.isSet(statsOption))
+    {
+        QJsonArray files;
+        for (int i = 0; i < results.size(); i++)
+        {
+            QJsonObject file = results.at(i).stats.toJson();
+            file.insert(QString("file"), results.at(i).input);
+            file.insert(QString("ok"), results.at(i).ok);
+            files.append(file);
+        }
+        QFile statsFile(parser.value(statsOption));
+        if (!statsFile.open(QIODevice::WriteOnly) ||
+                statsFile.write(QJsonDocument(files).toJson()) < 0)
+        {
+            err << "Can't write stats to " << statsFile.fileName() << endl;
+            return 1;
+        }
+    }
+
+    out << results.size() - failed << " of " << results.size() << " images rastered in "
+        << wallTime << " ms (" << cpuTime << " ms summed over " << threads << " threads)" << endl;
+
+    return failed ? 2 : 0;
+}
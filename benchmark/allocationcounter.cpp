@@ -0,0 +1,48 @@
+#include "allocationcounter.h"
+#include <QAtomicInteger>
+#include <cstdlib>
+#include <new>
+
+static QAtomicInteger<qint64> allocations;
+
+qint64 allocationCount() {return allocations.load();}
+
+#ifdef __GLIBC__
+
+extern "C" void *__libc_malloc(size_t);
+extern "C" void *__libc_calloc(size_t, size_t);
+extern "C" void *__libc_realloc(void *, size_t);
+
+extern "C" void *malloc(size_t size)
+{
+    allocations.fetchAndAddRelaxed(1);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    allocations.fetchAndAddRelaxed(1);
+    return __libc_calloc(count, size);
+}
+
+extern "C" void *realloc(void *p, size_t size)
+{
+    if (!p) allocations.fetchAndAddRelaxed(1);
+    return __libc_realloc(p, size);
+}
+
+#else
+
+void *operator new(size_t size)
+{
+    allocations.fetchAndAddRelaxed(1);
+    void *p = malloc(size);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void *operator new[](size_t size) {return operator new(size);}
+void operator delete(void *p) noexcept {free(p);}
+void operator delete[](void *p) noexcept {free(p);}
+
+#endif
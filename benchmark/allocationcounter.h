@@ -0,0 +1,12 @@
+#ifndef ALLOCATIONCOUNTER_H
+#define ALLOCATIONCOUNTER_H
+
+#include <QtGlobal>
+
+// Number of heap allocations made by the process so far. Qt containers
+// allocate through malloc(), so on glibc malloc itself is counted; other
+// platforms only see operator new.
+
+qint64 allocationCount();
+
+#endif // ALLOCATIONCOUNTER_H
@@ -0,0 +1,24 @@
+#-------------------------------------------------
+#
+# Per-stage benchmark of the rasterization core
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = eciser_benchmark
+TEMPLATE = app
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+include(../rasterhandler.pri)
+
+SOURCES += main.cpp \
+    imagegenerator.cpp \
+    stagebenchmark.cpp \
+    allocationcounter.cpp
+
+HEADERS  += imagegenerator.h \
+    stagebenchmark.h \
+    allocationcounter.h
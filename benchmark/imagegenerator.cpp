@@ -0,0 +1,109 @@
+#include "imagegenerator.h"
+#include <QVector>
+
+static const char *kindNames[ImageKinds] = {"flat", "antialiased", "gradient", "noise"};
+
+const char *imageKindName(ImageKind kind) {return kindNames[kind];}
+
+bool parseImageKind(const QString &name, ImageKind &kind)
+{
+    for (int k = 0; k < ImageKinds; k++) if (name == QString(kindNames[k]))
+    {
+        kind = ImageKind(k);
+        return true;
+    }
+    return false;
+}
+
+// xorshift, so the images don't depend on the C library
+
+static quint32 nextRandom(quint32 &state)
+{
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static QRgb blend(QRgb a, QRgb b, int w)
+{
+    return qRgb((qRed(a) * (256 - w) + qRed(b) * w) >> 8,
+                (qGreen(a) * (256 - w) + qGreen(b) * w) >> 8,
+                (qBlue(a) * (256 - w) + qBlue(b) * w) >> 8);
+}
+
+static void fillShapes(QImage &image, const QVector<QRgb> &palette, quint32 &state)
+{
+    int w = image.width(), h = image.height();
+    image.fill(palette.at(0));
+    for (int n = (w * h) / 64 + 1; n > 0; n--)
+    {
+        int x0 = nextRandom(state) % h, y0 = nextRandom(state) % w;
+        int x1 = qMin(h, x0 + 2 + int(nextRandom(state) % 24));
+        int y1 = qMin(w, y0 + 2 + int(nextRandom(state) % 24));
+        QRgb c = palette.at(nextRandom(state) % palette.size());
+        for (int x = x0; x < x1; x++)
+        {
+            QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(x));
+            for (int y = y0; y < y1; y++) line[y] = c;
+        }
+    }
+}
+
+// blends every pixel that differs from its lower or right neighbor with it
+
+static void smoothEdges(QImage &image)
+{
+    QImage source = image.copy();
+    for (int x = 0; x + 1 < image.height(); x++)
+    {
+        const QRgb *line = reinterpret_cast<const QRgb*>(source.constScanLine(x));
+        const QRgb *below = reinterpret_cast<const QRgb*>(source.constScanLine(x + 1));
+        QRgb *out = reinterpret_cast<QRgb*>(image.scanLine(x));
+        for (int y = 0; y + 1 < image.width(); y++)
+        {
+            if (line[y] != below[y]) out[y] = blend(line[y], below[y], 96);
+            else if (line[y] != line[y + 1]) out[y] = blend(line[y], line[y + 1], 160);
+        }
+    }
+}
+
+QImage generateImage(ImageKind kind, int width, int height, int colors, quint32 seed)
+{
+    QImage image(width, height, QImage::Format_RGB32);
+    quint32 state = seed ? seed : 1;
+    QVector<QRgb> palette;
+    for (int i = 0; i < qMax(colors, 1); i++)
+        palette.append(qRgb(nextRandom(state), nextRandom(state), nextRandom(state)));
+
+    switch (kind)
+    {
+    case FlatArt:
+        fillShapes(image, palette, state);
+        break;
+    case AntiAliased:
+        fillShapes(image, palette, state);
+        smoothEdges(image);
+        break;
+    case Gradient:
+        palette.append(qRgb(nextRandom(state), nextRandom(state), nextRandom(state)));
+        for (int x = 0; x < height; x++)
+        {
+            QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(x));
+            for (int y = 0; y < width; y++)
+            {
+                int step = (qint64)(x + y) * qMax(colors, 1) / (width + height - 1);
+                line[y] = blend(palette.at(0), palette.last(), step * 256 / qMax(colors, 1));
+            }
+        }
+        break;
+    default:
+        for (int x = 0; x < height; x++)
+        {
+            QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(x));
+            for (int y = 0; y < width; y++) line[y] = palette.at(nextRandom(state) % palette.size());
+        }
+        break;
+    }
+    return image;
+}
@@ -0,0 +1,21 @@
+#ifndef IMAGEGENERATOR_H
+#define IMAGEGENERATOR_H
+
+#include <QtGui/QImage>
+#include <QString>
+
+// Synthetic inputs covering what the rasterizer meets in practice. All of
+// them are deterministic for a given seed.
+//
+//  flat        pixel art: rectangles of `colors` flat colors
+//  antialiased the same shapes with blended one pixel borders
+//  gradient    a diagonal ramp between two colors in `colors` steps
+//  noise       uniformly random pixels from a `colors` sized palette
+
+enum ImageKind {FlatArt, AntiAliased, Gradient, Noise, ImageKinds};
+
+const char *imageKindName(ImageKind);
+bool parseImageKind(const QString &, ImageKind &);
+QImage generateImage(ImageKind, int width, int height, int colors, quint32 seed);
+
+#endif // IMAGEGENERATOR_H
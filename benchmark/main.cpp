@@ -0,0 +1,126 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QStringList>
+#include <QVector>
+#include "imagegenerator.h"
+#include "stagebenchmark.h"
+
+// Parses a comma separated list of positive integers
+
+static bool parseList(const QString &value, QVector<int> &list)
+{
+    QStringList items = value.split(QChar(','));
+    list.clear();
+    for (int i = 0; i < items.size(); i++)
+    {
+        bool ok;
+        int n = items.at(i).toInt(&ok);
+        if (!ok || n < 1) return false;
+        list.append(n);
+    }
+    return !list.isEmpty();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("eciser_benchmark");
+
+    QTextStream out(stdout), err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Times every rasterization stage on synthetic images.");
+    parser.addHelpOption();
+
+    QCommandLineOption kindsOption(QStringList() << "k" << "kinds",
+                                   "Image kinds: flat, antialiased, gradient, noise.", "list",
+                                   "flat,antialiased,gradient,noise");
+    QCommandLineOption sizesOption(QStringList() << "s" << "sizes",
+                                   "Square image sizes.", "list", "64,256,1024");
+    QCommandLineOption colorsOption(QStringList() << "c" << "colors",
+                                    "Source palette sizes.", "list", "4,16,64,512");
+    QCommandLineOption repeatOption(QStringList() << "r" << "repeat",
+                                    "Runs per stage, the fastest is reported.", "count", "3");
+    QCommandLineOption seedOption("seed", "Image generator seed.", "value", "1");
+    QCommandLineOption windowOption(QStringList() << "w" << "window",
+                                    "Shape color window size.", "size",
+                                    QString::number(DEFAULT_WINDOW));
+    QCommandLineOption cthresOption(QStringList() << "t" << "color-threshold",
+                                    "Shape color threshold.", "value",
+                                    QString::number(DEFAULT_COLOR_THRESHOLD));
+    QCommandLineOption fcthresOption(QStringList() << "f" << "fitting-threshold",
+                                     "Fitting color threshold.", "value",
+                                     QString::number(DEFAULT_FITTING_COLOR_THRESHOLD));
+    QCommandLineOption sdiamOption(QStringList() << "d" << "search-diameter",
+                                   "Search diameter.", "size",
+                                   QString::number(DEFAULT_SEARCH_DIAMETER));
+    QCommandLineOption threadsOption(QStringList() << "p" << "threads",
+                                     "Threads used by the stages.", "count",
+                                     QString::number(QThread::idealThreadCount()));
+    parser.addOption(kindsOption);
+    parser.addOption(sizesOption);
+    parser.addOption(colorsOption);
+    parser.addOption(repeatOption);
+    parser.addOption(seedOption);
+    parser.addOption(windowOption);
+    parser.addOption(cthresOption);
+    parser.addOption(fcthresOption);
+    parser.addOption(sdiamOption);
+    parser.addOption(threadsOption);
+    parser.process(a);
+
+    QVector<ImageKind> kinds;
+    QStringList kindNames = parser.value(kindsOption).split(QChar(','));
+    for (int i = 0; i < kindNames.size(); i++)
+    {
+        ImageKind kind;
+        if (!parseImageKind(kindNames.at(i), kind))
+        {
+            err << "Unknown image kind " << kindNames.at(i) << endl;
+            return 1;
+        }
+        kinds.append(kind);
+    }
+
+    QVector<int> sizes, colors;
+    bool ok[9];
+    ok[0] = parseList(parser.value(sizesOption), sizes);
+    ok[1] = parseList(parser.value(colorsOption), colors);
+    int repeat = parser.value(repeatOption).toInt(&ok[2]);
+    quint32 seed = parser.value(seedOption).toUInt(&ok[3]);
+    int window = parser.value(windowOption).toInt(&ok[4]);
+    int sdiam = parser.value(sdiamOption).toInt(&ok[5]);
+    int threads = parser.value(threadsOption).toInt(&ok[6]);
+    double cthres = parser.value(cthresOption).toDouble(&ok[7]);
+    double fcthres = parser.value(fcthresOption).toDouble(&ok[8]);
+    if (!ok[0] || !ok[1] || !ok[2] || !ok[3] || !ok[4] || !ok[5] || !ok[6] || !ok[7] || !ok[8] ||
+            repeat < 1 || window < 1 || sdiam < 1 || threads < 1)
+    {
+        err << "Invalid parameter." << endl;
+        return 1;
+    }
+
+    out << "kind\tsize\tcolors\tpalette\tstage\titems\tms\tmitems_per_s\tallocations" << endl;
+    for (int k = 0; k < kinds.size(); k++)
+        for (int s = 0; s < sizes.size(); s++)
+            for (int c = 0; c < colors.size(); c++)
+            {
+                QImage image = generateImage(kinds.at(k), sizes.at(s), sizes.at(s), colors.at(c), seed);
+                RasterHandler r(window, cthres, sdiam, fcthres);
+                r.setThreadCount(threads);
+                StageBenchmark benchmark(r, repeat);
+                QVector<StageResult> results = benchmark.run(image);
+                for (int i = 0; i < results.size(); i++)
+                {
+                    const StageResult &result = results.at(i);
+                    out << imageKindName(kinds.at(k)) << '\t' << sizes.at(s) << '\t' << colors.at(c) << '\t'
+                        << benchmark.paletteSize() << '\t' << result.stage << '\t' << result.items << '\t'
+                        << QString::number(result.nsecs / 1e6, 'f', 3) << '\t'
+                        << QString::number(result.nsecs ? result.items * 1e3 / result.nsecs : 0.0, 'f', 2)
+                        << '\t' << result.allocations << endl;
+                }
+            }
+
+    return 0;
+}
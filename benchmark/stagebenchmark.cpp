@@ -0,0 +1,87 @@
+#include "stagebenchmark.h"
+#include "allocationcounter.h"
+#include <QElapsedTimer>
+
+StageBenchmark::StageBenchmark(RasterHandler &r, int repeat) :
+    _r(r), _repeat(qMax(1, repeat)) {}
+
+template <typename F>
+void StageBenchmark::measure(const QString &stage, qint64 items, F body)
+{
+    StageResult result = {stage, items, -1, 0};
+    for (int i = 0; i < _repeat; i++)
+    {
+        QElapsedTimer timer;
+        qint64 allocations = allocationCount();
+        timer.start();
+        body();
+        qint64 nsecs = timer.nsecsElapsed();
+        if (result.nsecs < 0 || nsecs < result.nsecs)
+        {
+            result.nsecs = nsecs;
+            result.allocations = allocationCount() - allocations;
+        }
+    }
+    _results.append(result);
+}
+
+int StageBenchmark::paletteSize() const {return _r._c.size();}
+
+QVector<StageResult> StageBenchmark::run(const QImage &image)
+{
+    RasterHandler &r = _r;
+    qint64 pixels = (qint64)image.width() * image.height();
+
+    _results.clear();
+    r._original = image.convertToFormat(QImage::Format_RGB32);
+    r._loaded = true;
+    r.resetCancel();
+
+    measure(QString("shape_color"), pixels, [&]()
+    {
+        r._c.clear();
+        r.getShapeColor(NULL);
+    });
+    measure(QString("nearest_search"), pixels, [&]()
+    {
+        r.buildNearest();
+        r.searchNearestColors();
+    });
+    measure(QString("recolorization"), pixels, [&]()
+    {
+        r.prepareRaster();
+        r.recolorization();
+    });
+
+    // the neighbor searches, on the state the last run left behind: every
+    // pixel phase 1 didn't resolve, the field only takes phase 1 sources
+    QVector<QPoint> pending;
+    for (int i = 0; i < r.found.size(); i++) if (r.found.at(i) != ClassPlane::Phase1)
+        pending.append(QPoint(i / image.width(), i % image.width()));
+    if (r._sdiam >= NEIGHBOR_FIELD_DIAMETER && !pending.isEmpty())
+        r._field.build(r.found, r._rasterBits, r._rasterStride,
+                       image.width(), image.height(), r._spiralReach);
+
+    int found = 0;
+    qint64 steps = 0;
+    measure(QString("search"), pending.size(), [&]()
+    {
+        for (int i = 0; i < pending.size(); i++) found += r.search(pending.at(i), 3).size;
+    });
+    measure(QString("search2"), pending.size(), [&]()
+    {
+        QRgb target;
+        for (int i = 0; i < pending.size(); i++) found += r.search2(pending.at(i), target, steps);
+    });
+    measure(QString("search3"), pending.size(), [&]()
+    {
+        TriangleCache triangles;
+        QRgb target;
+        for (int i = 0; i < pending.size(); i++) found += r.search3(pending.at(i), target, triangles, steps);
+    });
+    r._field.clear();
+
+    // keeps the search loops from being optimized away
+    if (found < 0 || steps < 0) _results.clear();
+    return _results;
+}
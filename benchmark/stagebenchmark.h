@@ -0,0 +1,37 @@
+#ifndef STAGEBENCHMARK_H
+#define STAGEBENCHMARK_H
+
+#include <QtGui/QImage>
+#include <QString>
+#include <QVector>
+#include "rasterhandler.h"
+
+struct StageResult
+{
+    QString stage;
+    qint64 items;           // pixels the stage works on
+    qint64 nsecs;           // best of the repeats
+    qint64 allocations;     // heap allocations of that run
+};
+
+// Times every RasterHandler stage on its own. Stages run in pipeline order
+// on one handler so each starts from the real output of the previous ones;
+// search(), search2() and search3() are timed over the pixels phase 1
+// leaves unresolved, without writing any result.
+
+class StageBenchmark
+{
+public:
+    StageBenchmark(RasterHandler &, int repeat);
+    QVector<StageResult> run(const QImage &);
+    int paletteSize() const;
+
+private:
+    template <typename F> void measure(const QString &, qint64 items, F body);
+
+    RasterHandler &_r;
+    int _repeat;
+    QVector<StageResult> _results;
+};
+
+#endif // STAGEBENCHMARK_H
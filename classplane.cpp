@@ -0,0 +1,50 @@
+#include "classplane.h"
+#include <cstring>
+
+#define PLANE_ALIGNMENT 64
+
+ClassPlane::ClassPlane() : _data(0), _size(0) {}
+
+ClassPlane::~ClassPlane()
+{
+    qFreeAligned(_data);
+}
+
+void ClassPlane::allocate(int size)
+{
+    if (size != _size)
+    {
+        qFreeAligned(_data);
+        // rounded up so whole words can always be read
+        _data = (uchar *)qMallocAligned((size + sizeof(quint64)) & ~(sizeof(quint64) - 1),
+                                        PLANE_ALIGNMENT);
+        _size = size;
+    }
+}
+
+void ClassPlane::reset(int size)
+{
+    allocate(size);
+    memset(_data, Unresolved, size);
+}
+
+int ClassPlane::nextUnresolved(int from, int end) const
+{
+    const quint64 ones = Q_UINT64_C(0x0101010101010101);
+    const quint64 highs = Q_UINT64_C(0x8080808080808080);
+
+    while (from < end && (from & (sizeof(quint64) - 1)))
+        if (_data[from] == Unresolved) return from; else from++;
+
+    // a word holds a zero byte iff (w - ones) & ~w & highs is non-zero
+    for (; from + (int)sizeof(quint64) <= end; from += sizeof(quint64))
+    {
+        quint64 w;
+        memcpy(&w, _data + from, sizeof(w));
+        if ((w - ones) & ~w & highs) break;
+    }
+
+    for (; from < end; from++)
+        if (_data[from] == Unresolved) return from;
+    return end;
+}
@@ -0,0 +1,33 @@
+#ifndef CLASSPLANE_H
+#define CLASSPLANE_H
+
+#include <QtGlobal>
+
+// Per-pixel recolorization class, one byte per pixel in a cache line
+// aligned buffer. nextUnresolved() skips resolved spans a machine word at
+// a time.
+
+class ClassPlane
+{
+public:
+    enum PixelClass {Unresolved = 0, Phase1, Phase2, Phase3};
+
+    ClassPlane();
+    ~ClassPlane();
+    void reset(int size);
+    int nextUnresolved(int from, int end) const;
+
+    inline uchar at(int i) const {return _data[i];}
+    inline void set(int i, PixelClass c) {_data[i] = c;}
+    inline int size() const {return _size;}
+    inline const uchar *constData() const {return _data;}
+
+private:
+    Q_DISABLE_COPY(ClassPlane)
+    void allocate(int);
+
+    uchar *_data;
+    int _size;
+};
+
+#endif // CLASSPLANE_H
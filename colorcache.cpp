@@ -0,0 +1,21 @@
+#include "colorcache.h"
+
+#define CACHE_MIN_BITS 10
+
+ColorCache::ColorCache() : _table(CACHE_MIN_BITS)
+{
+    clear();
+}
+
+void ColorCache::clear()
+{
+    _hits = _misses = 0;
+    _table.clear();
+}
+
+void ColorCache::insert(QRgb color, int index, int dist)
+{
+    Nearest &n = _table.insert((color & 0x00ffffff) | CACHE_USED);
+    n.index = index;
+    n.dist = dist;
+}
@@ -0,0 +1,46 @@
+#ifndef COLORCACHE_H
+#define COLORCACHE_H
+
+#include <QtGui/QColor>
+#include "hashtable.h"
+
+// Memoizes nearest palette lookups by packed RGB so every distinct source
+// color is searched once. Hits and misses are counted for reporting.
+
+class ColorCache
+{
+public:
+    ColorCache();
+    void clear();
+    void insert(QRgb, int index, int dist);
+
+    inline bool lookup(QRgb color, int &index, int &dist)
+    {
+        const Nearest *n = _table.find((color & 0x00ffffff) | CACHE_USED);
+        if (!n)
+        {
+            _misses++;
+            return false;
+        }
+        index = n->index;
+        dist = n->dist;
+        _hits++;
+        return true;
+    }
+
+    qint64 hits() const {return _hits;}
+    qint64 misses() const {return _misses;}
+    int size() const {return _table.size();}
+
+private:
+    enum {CACHE_USED = 0x01000000};
+    struct Nearest
+    {
+        qint32 index, dist;
+    };
+
+    HashTable<quint32, Nearest> _table;
+    qint64 _hits, _misses;
+};
+
+#endif // COLORCACHE_H
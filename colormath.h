@@ -0,0 +1,23 @@
+#ifndef COLORMATH_H
+#define COLORMATH_H
+
+#include <QtGui/QColor>
+
+// Integer color math on packed RGB, exact for 8-bit channels. Squared
+// distances fit in an int; products of two of them need 64 bits.
+
+inline int colorDistance(QRgb a, QRgb b)
+{
+    int r = qRed(a) - qRed(b), g = qGreen(a) - qGreen(b), bl = qBlue(a) - qBlue(b);
+    return r * r + g * g + bl * bl;
+}
+
+// (a1 - a0) . (b1 - b0)
+inline int colorDot(QRgb a0, QRgb a1, QRgb b0, QRgb b1)
+{
+    return (qRed(a1) - qRed(a0)) * (qRed(b1) - qRed(b0)) +
+           (qGreen(a1) - qGreen(a0)) * (qGreen(b1) - qGreen(b0)) +
+           (qBlue(a1) - qBlue(a0)) * (qBlue(b1) - qBlue(b0));
+}
+
+#endif // COLORMATH_H
@@ -0,0 +1,29 @@
+#include "colorpalette.h"
+
+#define PALETTE_MIN_BITS 4
+
+ColorPalette::ColorPalette() : _indices(PALETTE_MIN_BITS) {}
+
+int ColorPalette::insert(QRgb color)
+{
+    color &= 0x00ffffff;
+    int size = _indices.size();
+    int &index = _indices.insert(color | PALETTE_USED);
+    if (_indices.size() == size) return index;
+
+    index = _colors.size();
+    _colors.append(color);
+    return index;
+}
+
+void ColorPalette::clear()
+{
+    _colors.clear();
+    _indices.clear();
+}
+
+void ColorPalette::reserve(int size)
+{
+    _colors.reserve(size);
+    _indices.reserve(size);
+}
@@ -0,0 +1,39 @@
+#ifndef COLORPALETTE_H
+#define COLORPALETTE_H
+
+#include <QtGui/QColor>
+#include <QVector>
+#include "hashtable.h"
+
+// Insertion ordered set of 24-bit RGB colors. Lookups go through a hash
+// table, so both insert() and indexOf() are O(1) regardless of how many
+// colors the palette holds. The alpha byte of incoming QRgb values is
+// ignored.
+
+class ColorPalette
+{
+public:
+    ColorPalette();
+    int insert(QRgb);
+    void clear();
+    void reserve(int);
+
+    inline int indexOf(QRgb color) const
+    {
+        const int *index = _indices.find((color & 0x00ffffff) | PALETTE_USED);
+        return index ? *index : -1;
+    }
+    inline bool contains(QRgb color) const {return indexOf(color) >= 0;}
+    inline QRgb at(int i) const {return _colors.at(i);}
+    inline int size() const {return _colors.size();}
+    inline bool isEmpty() const {return _colors.isEmpty();}
+    inline const QVector<QRgb> &colors() const {return _colors;}
+
+private:
+    enum {PALETTE_USED = 0x01000000};
+
+    QVector<QRgb> _colors;
+    HashTable<quint32, int> _indices;
+};
+
+#endif // COLORPALETTE_H
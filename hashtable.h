@@ -0,0 +1,95 @@
+#ifndef HASHTABLE_H
+#define HASHTABLE_H
+
+#include <QtGlobal>
+#include <QVector>
+
+// Open addressing hash table with linear probing for the small POD keys of
+// the per-pixel caches, grown to stay at most half full so probes stay
+// short. A value initialized Key marks a free slot and can't be stored, and
+// hashKey() has to be overloaded for Key; entries are never removed one by
+// one, only all at once by clear().
+
+inline quint32 hashKey(quint32 key) {return key * 2654435761u;}
+
+template <typename Key, typename Value>
+class HashTable
+{
+public:
+    explicit HashTable(int minBits) : _minBits(minBits) {clear();}
+
+    void clear()
+    {
+        _size = 0;
+        _entries.clear();
+        rehash(_minBits);
+    }
+
+    void reserve(int size)
+    {
+        int bits = _minBits;
+        while ((1 << bits) < 2 * size) bits++;
+        if (bits > 32 - _shift) rehash(bits);
+    }
+
+    inline const Value *find(const Key &key) const
+    {
+        for (unsigned i = slot(key); ; i = (i + 1) & _mask)
+        {
+            const Entry &e = _entries.at(i);
+            if (e.key == Key()) return NULL;
+            if (e.key == key) return &e.value;
+        }
+    }
+
+    // Value stored under `key`, added value initialized if it is missing
+    Value &insert(const Key &key)
+    {
+        unsigned i = slot(key);
+        for (; !(_entries.at(i).key == Key()); i = (i + 1) & _mask)
+            if (_entries.at(i).key == key) return _entries[i].value;
+
+        if (2 * (_size + 1) > _entries.size())
+        {
+            rehash(33 - _shift);
+            for (i = slot(key); !(_entries.at(i).key == Key()); i = (i + 1) & _mask) ;
+        }
+        _size++;
+        _entries[i].key = key;
+        _entries[i].value = Value();
+        return _entries[i].value;
+    }
+
+    inline int size() const {return _size;}
+
+private:
+    struct Entry
+    {
+        Key key;
+        Value value;
+    };
+
+    inline unsigned slot(const Key &key) const {return hashKey(key) >> _shift;}
+
+    void rehash(int bits)
+    {
+        QVector<Entry> old;
+        old.swap(_entries);
+
+        _shift = 32 - bits;
+        _mask = (1u << bits) - 1;
+        _entries.fill(Entry(), 1 << bits);
+        for (int e = 0; e < old.size(); e++) if (!(old.at(e).key == Key()))
+        {
+            unsigned i = slot(old.at(e).key);
+            while (!(_entries.at(i).key == Key())) i = (i + 1) & _mask;
+            _entries[i] = old.at(e);
+        }
+    }
+
+    QVector<Entry> _entries;
+    unsigned _mask;
+    int _shift, _size, _minBits;
+};
+
+#endif // HASHTABLE_H
@@ -1,12 +1,17 @@
-#include "mainwindow.h"
-#include <QApplication>
-
-int main(int argc, char *argv[])
-{
-    QApplication a(argc, argv);
-    MainWindow w;
-    if (argc == 2 && strcmp(argv[1], "--debug") == 0) w.setRasterHandlerDebugOn();
-    w.show();
-
-    return a.exec();
-}
+#include "mainwindow.h"
+#include <QApplication>
+
+int main(int argc, char *argv[])
+{
+    QApplication a(argc, argv);
+    MainWindow w;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--debug") == 0) w.setRasterHandlerDebugOn();
+        else if (strcmp(argv[i], "--trace") == 0 && i + 1 < argc)
+            w.setRasterHandlerTrace(QString::fromLocal8Bit(argv[++i]));
+    }
+    w.show();
+
+    return a.exec();
+}
@@ -0,0 +1,240 @@
+#include "nearestcolor.h"
+#include "colormath.h"
+#include <climits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NEAREST_SSE2
+#include <emmintrin.h>
+#endif
+
+#if defined(NEAREST_SSE2) && (defined(__GNUC__) || defined(__clang__))
+#define NEAREST_AVX2
+#include <immintrin.h>
+#endif
+
+// Padding entries sit far outside the RGB cube, yet their 16-bit
+// differences and squares still fit the multiply-add lanes.
+#define NEAREST_PAD 1023
+#define NEAREST_LANES 8
+
+// The grid gets about NEAREST_CELL_COLORS palette colors per cell if they
+// were spread evenly, and at most 1 << NEAREST_MAX_GRID_BITS cells per axis
+#define NEAREST_CELL_COLORS 4
+#define NEAREST_MAX_GRID_BITS 5
+
+typedef int (*NearestKernel)(const quint32 *, const quint32 *, int, QRgb, int &);
+
+#ifndef NEAREST_SSE2
+static int nearestScalar(const quint32 *rg, const quint32 *b, int n, QRgb q, int &dist)
+{
+    int best = -1;
+    dist = INT_MAX;
+    for (int i = 0; i < n; i++)
+    {
+        int dr = int(rg[i] & 0xffff) - qRed(q);
+        int dg = int(rg[i] >> 16) - qGreen(q);
+        int db = int(b[i]) - qBlue(q);
+        int d = dr * dr + dg * dg + db * db;
+        if (d < dist) {dist = d; best = i;}
+    }
+    return best;
+}
+#endif
+
+#ifdef NEAREST_SSE2
+// Picks the smallest lane distance, the lowest index among equal ones.
+static int reduceLanes(const int *d, const int *idx, int lanes, int &dist)
+{
+    int best = -1;
+    dist = INT_MAX;
+    for (int i = 0; i < lanes; i++)
+        if (d[i] < dist || (d[i] == dist && idx[i] < best)) {dist = d[i]; best = idx[i];}
+    return best;
+}
+
+static int nearestSse2(const quint32 *rg, const quint32 *b, int n, QRgb q, int &dist)
+{
+    __m128i qrg = _mm_set1_epi32((qGreen(q) << 16) | qRed(q));
+    __m128i qb = _mm_set1_epi32(qBlue(q));
+    __m128i bestD = _mm_set1_epi32(INT_MAX), bestI = _mm_setzero_si128();
+    __m128i idx = _mm_setr_epi32(0, 1, 2, 3), step = _mm_set1_epi32(4);
+
+    for (int i = 0; i < n; i += 4)
+    {
+        __m128i d1 = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)(rg + i)), qrg);
+        __m128i d2 = _mm_sub_epi16(_mm_loadu_si128((const __m128i *)(b + i)), qb);
+        __m128i d = _mm_add_epi32(_mm_madd_epi16(d1, d1), _mm_madd_epi16(d2, d2));
+        __m128i lt = _mm_cmplt_epi32(d, bestD);
+        bestD = _mm_or_si128(_mm_and_si128(lt, d), _mm_andnot_si128(lt, bestD));
+        bestI = _mm_or_si128(_mm_and_si128(lt, idx), _mm_andnot_si128(lt, bestI));
+        idx = _mm_add_epi32(idx, step);
+    }
+
+    int d[4], j[4];
+    _mm_storeu_si128((__m128i *)d, bestD);
+    _mm_storeu_si128((__m128i *)j, bestI);
+    return reduceLanes(d, j, 4, dist);
+}
+#endif
+
+#ifdef NEAREST_AVX2
+__attribute__((target("avx2")))
+static int nearestAvx2(const quint32 *rg, const quint32 *b, int n, QRgb q, int &dist)
+{
+    __m256i qrg = _mm256_set1_epi32((qGreen(q) << 16) | qRed(q));
+    __m256i qb = _mm256_set1_epi32(qBlue(q));
+    __m256i bestD = _mm256_set1_epi32(INT_MAX), bestI = _mm256_setzero_si256();
+    __m256i idx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7), step = _mm256_set1_epi32(8);
+
+    for (int i = 0; i < n; i += 8)
+    {
+        __m256i d1 = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i *)(rg + i)), qrg);
+        __m256i d2 = _mm256_sub_epi16(_mm256_loadu_si256((const __m256i *)(b + i)), qb);
+        __m256i d = _mm256_add_epi32(_mm256_madd_epi16(d1, d1), _mm256_madd_epi16(d2, d2));
+        __m256i lt = _mm256_cmpgt_epi32(bestD, d);
+        bestD = _mm256_blendv_epi8(bestD, d, lt);
+        bestI = _mm256_blendv_epi8(bestI, idx, lt);
+        idx = _mm256_add_epi32(idx, step);
+    }
+
+    int d[8], j[8];
+    _mm256_storeu_si256((__m256i *)d, bestD);
+    _mm256_storeu_si256((__m256i *)j, bestI);
+    return reduceLanes(d, j, 8, dist);
+}
+#endif
+
+static NearestKernel selectKernel(const char **name)
+{
+#ifdef NEAREST_AVX2
+    // runs from a static initializer, before libgcc has probed the cpu
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {*name = "avx2"; return nearestAvx2;}
+#endif
+#ifdef NEAREST_SSE2
+    *name = "sse2";
+    return nearestSse2;
+#else
+    *name = "scalar";
+    return nearestScalar;
+#endif
+}
+
+static const char *kernelLabel;
+static const NearestKernel kernel = selectKernel(&kernelLabel);
+
+NearestColor::NearestColor() : _size(0), _gridBits(0) {}
+
+void NearestColor::build(const ColorPalette &palette)
+{
+    _size = palette.size();
+    _gridBits = 0;
+    _cellStart.clear();
+    _cellColors.clear();
+    _cellIndex.clear();
+    if (_size > NEAREST_BRUTE_FORCE_COLORS)
+    {
+        _rg.clear();
+        _b.clear();
+        buildGrid(palette);
+        return;
+    }
+
+    int padded = (_size + NEAREST_LANES - 1) / NEAREST_LANES * NEAREST_LANES;
+    _rg.fill(NEAREST_PAD << 16 | NEAREST_PAD, padded);
+    _b.fill(NEAREST_PAD, padded);
+    for (int i = 0; i < _size; i++)
+    {
+        QRgb c = palette.at(i);
+        _rg[i] = qGreen(c) << 16 | qRed(c);
+        _b[i] = qBlue(c);
+    }
+}
+
+// Counting sort of the palette into the cells, so every cell lists its
+// colors by increasing palette index
+
+void NearestColor::buildGrid(const ColorPalette &palette)
+{
+    _gridBits = 1;
+    while (_gridBits < NEAREST_MAX_GRID_BITS && (NEAREST_CELL_COLORS << 3 * _gridBits) < _size)
+        _gridBits++;
+
+    int cells = 1 << 3 * _gridBits;
+    _cellStart.fill(0, cells + 1);
+    for (int i = 0; i < _size; i++) _cellStart[cellOf(palette.at(i)) + 1]++;
+    for (int c = 0; c < cells; c++) _cellStart[c + 1] += _cellStart.at(c);
+
+    QVector<int> next = _cellStart;
+    _cellColors.resize(_size);
+    _cellIndex.resize(_size);
+    for (int i = 0; i < _size; i++)
+    {
+        int e = next[cellOf(palette.at(i))]++;
+        _cellColors[e] = palette.at(i);
+        _cellIndex[e] = i;
+    }
+}
+
+int NearestColor::nearest(QRgb color, int &dist) const
+{
+    if (!_size)
+    {
+        dist = INT_MAX;
+        return -1;
+    }
+    if (_gridBits) return nearestInGrid(color, dist);
+    return kernel(_rg.constData(), _b.constData(), _rg.size(), color, dist);
+}
+
+// Shell k holds the cells k steps away from the query's cell along some
+// axis, so none of its colors is closer than the query's distance to the
+// faces of the (2k - 1)^3 block of cells around its own. The search stops
+// at the first shell whose bound exceeds the best distance found; a bound
+// equal to it may still hide a lower index.
+
+int NearestColor::nearestInGrid(QRgb color, int &dist) const
+{
+    int side = 1 << _gridBits, shift = 8 - _gridBits, width = 1 << shift;
+    int q[3] = {qRed(color), qGreen(color), qBlue(color)};
+    int c[3] = {q[0] >> shift, q[1] >> shift, q[2] >> shift};
+    int best = -1;
+    dist = INT_MAX;
+
+    for (int k = 0; k < side; k++)
+    {
+        if (k)
+        {
+            int gap = INT_MAX;
+            for (int a = 0; a < 3; a++)
+            {
+                if (c[a] + k < side) gap = qMin(gap, ((c[a] + k) << shift) - q[a]);
+                if (c[a] - k >= 0) gap = qMin(gap, q[a] - ((c[a] - k) << shift) - width + 1);
+            }
+            if (gap == INT_MAX) break;
+            if (gap * gap > dist) break;
+        }
+
+        int r0 = qMax(0, c[0] - k), r1 = qMin(side - 1, c[0] + k);
+        int g0 = qMax(0, c[1] - k), g1 = qMin(side - 1, c[1] + k);
+        for (int r = r0; r <= r1; r++) for (int g = g0; g <= g1; g++)
+        {
+            // off the shell's r and g faces only its two b faces are new
+            bool face = qAbs(r - c[0]) == k || qAbs(g - c[1]) == k;
+            for (int b = c[2] - k; b <= c[2] + k; b += face ? 1 : 2 * k)
+            {
+                if (b < 0 || b >= side) continue;
+                int cell = (r << _gridBits | g) << _gridBits | b;
+                for (int e = _cellStart.at(cell); e < _cellStart.at(cell + 1); e++)
+                {
+                    int d = colorDistance(_cellColors.at(e), color);
+                    int i = _cellIndex.at(e);
+                    if (d < dist || (d == dist && i < best)) {dist = d; best = i;}
+                }
+            }
+        }
+    }
+    return best;
+}
+
+const char *NearestColor::kernelName() {return kernelLabel;}
@@ -0,0 +1,50 @@
+#ifndef NEARESTCOLOR_H
+#define NEARESTCOLOR_H
+
+#include <QtGui/QColor>
+#include <QVector>
+#include "colorpalette.h"
+
+// palettes up to NEAREST_BRUTE_FORCE_COLORS colors are searched exhaustively
+#define NEAREST_BRUTE_FORCE_COLORS 256
+
+// Exact nearest palette color search, const and safe to call from any
+// number of threads. Ties resolve to the lowest palette index.
+//
+// Small palettes are searched exhaustively. They are laid out as (r, g) and
+// (b, 0) 16-bit pairs so a single multiply-add yields the squared distance
+// of 4 (SSE2) or 8 (AVX2) colors at once; the widest kernel the CPU
+// supports is picked at run time. Larger palettes are bucketed in a uniform
+// grid over the RGB cube, searched in shells of cells around the query's
+// cell until no closer cell is left.
+
+class NearestColor
+{
+public:
+    NearestColor();
+    void build(const ColorPalette &);
+    int nearest(QRgb, int &dist) const;
+    int size() const {return _size;}
+    bool usesGrid() const {return _gridBits > 0;}
+
+    static const char *kernelName();
+
+private:
+    void buildGrid(const ColorPalette &);
+    int nearestInGrid(QRgb, int &dist) const;
+    inline int cellOf(QRgb c) const
+    {
+        int shift = 8 - _gridBits;
+        return ((qRed(c) >> shift) << _gridBits | qGreen(c) >> shift) << _gridBits | qBlue(c) >> shift;
+    }
+
+    int _size;
+    QVector<quint32> _rg, _b;   // padded to a multiple of 8 with far colors
+
+    int _gridBits;              // cells per axis as a power of two, 0 without grid
+    QVector<int> _cellStart;    // first entry of every cell, and the end
+    QVector<QRgb> _cellColors;  // palette colors by cell, in palette order
+    QVector<int> _cellIndex;
+};
+
+#endif // NEARESTCOLOR_H
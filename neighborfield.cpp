@@ -0,0 +1,60 @@
+#include "neighborfield.h"
+
+NeighborField::NeighborField() {}
+
+void NeighborField::clear()
+{
+    _count.clear();
+    _dist.clear();
+}
+
+void NeighborField::build(const ClassPlane &plane, const QRgb *bits, int stride,
+                          int width, int height, int reach)
+{
+    int size = width * height;
+    QVector<QRgb> colors(size * NEIGHBOR_COLORS);
+    QVector<int> frontier, next;    // color slots, i * NEIGHBOR_COLORS + k, of the current ring
+    int x, y, d;
+
+    _count.fill(0, size);
+    _dist.fill(0, size * NEIGHBOR_COLORS);
+    uchar *count = _count.data();
+    ushort *dist = _dist.data();
+    QRgb *color = colors.data();
+
+    for (x = 1; x < height; x++) for (y = 1; y < width; y++)
+    {
+        int i = x * width + y;
+        if (plane.at(i) != ClassPlane::Phase1) continue;
+        color[i * NEIGHBOR_COLORS] = bits[x * stride + y];
+        count[i] = 1;
+        frontier << i * NEIGHBOR_COLORS;
+    }
+
+    // a color is only passed on by the pixels that kept it: a pixel that
+    // is full already holds NEIGHBOR_COLORS colors at least as close to
+    // everything behind it
+    for (d = 1; d <= reach && !frontier.isEmpty(); d++)
+    {
+        next.clear();
+        for (int f = 0; f < frontier.size(); f++)
+        {
+            int from = frontier.at(f) / NEIGHBOR_COLORS;
+            QRgb c = color[frontier.at(f)];
+            int fx = from / width, fy = from % width;
+            for (x = qMax(0, fx - 1); x <= qMin(height - 1, fx + 1); x++)
+                for (y = qMax(0, fy - 1); y <= qMin(width - 1, fy + 1); y++)
+                {
+                    int i = x * width + y, n = count[i], k;
+                    if (n == NEIGHBOR_COLORS) continue;
+                    for (k = 0; k < n && color[i * NEIGHBOR_COLORS + k] != c; k++) ;
+                    if (k < n) continue;
+                    color[i * NEIGHBOR_COLORS + n] = c;
+                    dist[i * NEIGHBOR_COLORS + n] = d;
+                    count[i] = n + 1;
+                    next << i * NEIGHBOR_COLORS + n;
+                }
+        }
+        frontier.swap(next);
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef NEIGHBORFIELD_H
+#define NEIGHBORFIELD_H
+
+#include <QtGui/QColor>
+#include <QVector>
+#include "classplane.h"
+
+#define NEIGHBOR_COLORS 3
+
+// Chebyshev distance from every pixel to its NEIGHBOR_COLORS nearest
+// distinct phase 1 colors, up to `reach`. Built by a multi-source BFS over
+// the 8-connected grid in which each pixel keeps the first NEIGHBOR_COLORS
+// colors that reach it, so the whole field costs O(pixels) per color.
+// Pixels in row 0 or column 0 are never sources, as in posJudge().
+
+class NeighborField
+{
+public:
+    NeighborField();
+    void build(const ClassPlane &, const QRgb *bits, int stride, int width, int height, int reach);
+    void clear();
+
+    inline bool isEmpty() const {return _count.isEmpty();}
+    inline int count(int i) const {return _count.at(i);}
+    inline int distance(int i, int k) const {return _dist.at(i * NEIGHBOR_COLORS + k);}
+
+private:
+    QVector<uchar> _count;      // distinct colors found within reach
+    QVector<ushort> _dist;      // their distances, nearest first
+};
+
+#endif // NEIGHBORFIELD_H
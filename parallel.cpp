@@ -0,0 +1,76 @@
+#include "parallel.h"
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QMutex>
+#include <QWaitCondition>
+
+namespace {
+
+// Shared between the caller and its helpers. A helper that only gets
+// scheduled after the caller has returned finds no index left and never
+// touches `body`, which lives on the caller's stack.
+
+struct ParallelState
+{
+    QAtomicInt next;
+    int count;
+    const std::function<void(int)> *body;
+    QMutex lock;
+    QWaitCondition idle;
+    int running;
+};
+
+void work(ParallelState *state)
+{
+    state->lock.lock();
+    state->running++;
+    state->lock.unlock();
+
+    int i;
+    while ((i = state->next.fetchAndAddRelaxed(1)) < state->count)
+        (*state->body)(i);
+
+    state->lock.lock();
+    if (--state->running == 0) state->idle.wakeAll();
+    state->lock.unlock();
+}
+
+class ParallelHelper : public QRunnable
+{
+public:
+    ParallelHelper(const QSharedPointer<ParallelState> &state) : _state(state) {}
+    void run() {work(_state.data());}
+
+private:
+    QSharedPointer<ParallelState> _state;
+};
+
+}
+
+void parallelFor(int count, int threads, const std::function<void(int)> &body)
+{
+    if (count <= 0) return;
+    if (threads <= 1 || count == 1)
+    {
+        for (int i = 0; i < count; i++) body(i);
+        return;
+    }
+
+    QSharedPointer<ParallelState> state(new ParallelState);
+    state->next.store(0);
+    state->count = count;
+    state->body = &body;
+    state->running = 0;
+
+    int helpers = (threads < count ? threads : count) - 1;
+    for (int i = 0; i < helpers; i++)
+        QThreadPool::globalInstance()->start(new ParallelHelper(state));
+
+    work(state.data());
+
+    state->lock.lock();
+    while (state->running) state->idle.wait(&state->lock);
+    state->lock.unlock();
+}
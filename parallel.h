@@ -0,0 +1,13 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <functional>
+
+// Runs body(0) .. body(count - 1) on at most `threads` threads of the global
+// QThreadPool, the calling thread included, and returns once every index has
+// been processed. Indices are handed out dynamically, so the order in which
+// they run is unspecified.
+
+void parallelFor(int count, int threads, const std::function<void(int)> &body);
+
+#endif // PARALLEL_H
@@ -0,0 +1,29 @@
+#include "progressreporter.h"
+
+ProgressReporter::ProgressReporter() : _from(0), _span(0), _total(1) {}
+
+// not thread safe, called between stages
+
+void ProgressReporter::start(int from, int to, qint64 total)
+{
+    _from = from;
+    _span = to - from;
+    _total = qMax(total, Q_INT64_C(1));
+    _done.store(0);
+    _percent.store(from);
+}
+
+// Returns the new percentage, or -1 when it did not change
+
+int ProgressReporter::advance(qint64 units)
+{
+    qint64 done = _done.fetchAndAddRelaxed(units) + units;
+    int percent = _from + int(_span * qMin(done, _total) / _total);
+    int last = _percent.load();
+    while (percent > last)
+    {
+        if (_percent.testAndSetRelaxed(last, percent)) return percent;
+        last = _percent.load();
+    }
+    return -1;
+}
@@ -0,0 +1,26 @@
+#ifndef PROGRESSREPORTER_H
+#define PROGRESSREPORTER_H
+
+#include <QAtomicInt>
+#include <QAtomicInteger>
+
+// Maps the work units done in a stage onto its [from, to] share of the
+// progress bar. Workers add their units concurrently and only the one that
+// moves the integer percentage forward gets it back, so a stage reports at
+// most to - from times however finely its work is counted.
+
+class ProgressReporter
+{
+public:
+    ProgressReporter();
+    void start(int from, int to, qint64 total);
+    int advance(qint64 units);
+
+private:
+    int _from, _span;
+    qint64 _total;
+    QAtomicInteger<qint64> _done;
+    QAtomicInt _percent;
+};
+
+#endif // PROGRESSREPORTER_H
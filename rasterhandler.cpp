@@ -1,383 +1,968 @@
-#include "rasterhandler.h"
-
-RasterHandler::RasterHandler()
-{
-    //initialization
-
-    _loaded = false;
-    _rastered = false;
-    _debug = false;
-
-    //ANN init
-
-    queryPt = annAllocPt(DIMENSIONS);
-    dataPts = annAllocPts(MAX_COLORS, DIMENSIONS);
-    nnIdx = new ANNidx[NEAREST_POINTS];
-    dists = new ANNdist[NEAREST_POINTS];
-
-    //default setting
-
-    _window = DEFAULT_WINDOW;
-    _cthres = DEFAULT_COLOR_THRESHOLD;
-    _fcthres = DEFAULT_FITTING_COLOR_THRESHOLD;
-    _sdiam = DEFAULT_SEARCH_DIAMETER;
-
-}
-
-RasterHandler::RasterHandler(int window, double cthres, int sdiam, double fcthres)
-{
-    setWindow(window);
-    setColorThreshold(cthres);
-    setSearchDiameter(sdiam);
-    setFittingColorThreshold(fcthres);
-}
-
-void RasterHandler::setDebugON()
-{
-    _debug = true;
-    p_debug.setFileName("output.debug");
-    f_debug.setFileName("found.map");
-}
-
-void RasterHandler::setOriginal(QString path)
-{
-    _rastered = false;
-    _loaded = _original.load(path);
-    if (_original.width() > MAX_PIXELS || _original.height() > MAX_PIXELS)
-        _loaded = false;
-    if (_loaded)
-        emit statusUpdate(QString("Image loaded."));
-}
-
-void RasterHandler::setWindow(int window) {_window = window;}
-void RasterHandler::setColorThreshold(double cthres) {_cthres = cthres;}
-void RasterHandler::setFittingColorThreshold (double fcthres) {_fcthres = fcthres;}
-void RasterHandler::setSearchDiameter(int sdiam) { _sdiam = sdiam;}
-
-const QImage &RasterHandler::getOriginal() {return _original;}
-const QImage &RasterHandler::getRastered() {return _raster;}
-int RasterHandler::getWindow() {return _window;}
-int RasterHandler::getSearchDiameter() {return _sdiam;}
-double RasterHandler::getColorThreshold() {return _cthres;}
-double RasterHandler::getFittingColorThreshold() {return _fcthres;}
-
-bool RasterHandler::isLoaded() {return _loaded;}
-bool RasterHandler::isRastered() {return _rastered;}
-
-// Rasterization invoker
-
-void RasterHandler::raster()
-{
-    if (!_loaded) return;
-    _raster = _original;
-    found.fill('0', _original.width() * _original.height());
-    if (_debug)
-    {
-        if (!p_debug.open(QIODevice::WriteOnly | QIODevice::Text))
-            _debug = false;
-        if (!f_debug.open(QIODevice::WriteOnly | QIODevice::Text))
-            _debug = false;
-        debug_out.setDevice(&p_debug);
-        debug_out.setRealNumberNotation(QTextStream::FixedNotation);
-        debug_out.setRealNumberPrecision(2);
-    }
-
-    emit processPercentage(0);
-    emit statusUpdate(QString("Start rastering..."));
-
-    emit statusUpdate(QString("Start searching shape color..."));
-    getShapeColor();
-    buildANNS();
-
-    recolorization();
-    _rastered = true;
-    delete kdTree;
-
-    if (_debug)
-    {
-        p_debug.close();
-        f_debug.close();
-    }
-    emit processPercentage(0);
-    emit statusUpdate(QString("Done."));
-    emit finished();
-}
-
-// Raster related private function
-
-void RasterHandler::getShapeColor()
-{
-    int width = _original.width();
-    int height = _original.height();
-    int i,j,x,y;
-    bool* table = new bool[width*height]();
-\
-    _c.clear();
-    for (x = 0; x < height - _window; x++) for (y = 0; y < width - _window; y++)
-    {
-        emit processPercentage((int)50*(double)(x*width+y+1)/(height*width));
-        if (table[x*width+y]) continue;
-        QColor color(_original.pixel(y, x));
-        bool flag = true;
-        for (i = 0; i < _window; i++) for (j = 0; j < _window; j++)
-        {
-            double c[3], p[3], cp[3];
-            convertColorToVector(QColor(_original.pixel(y+j, x+i)), p);
-            convertColorToVector(color, c);
-            vectorMinus(cp, p, c);
-            if (vectorDotProduct(cp) > _cthres * _cthres && flag)
-            {
-                flag = false;
-                break;
-            }
-        }
-        if (flag)
-        {
-            if (!_c.contains(color)) _c.append(color);
-            for (i = 0; i < _window; i++) for (j = 0; j < _window; j++)
-                table[(x+i)*width+y+j] = true;
-        }
-    }
-
-    delete table;
-}
-
-void RasterHandler::recolorization()
-{
-    int width = _raster.width();
-    int height = _raster.height();
-    int x,y;
-
-    // phase 1 : find all case 1 pixels
-    emit statusUpdate(QString("Recolorization phase 1..."));
-    for (x = 0; x < height; x++) for (y = 0; y < width; y++)
-    {
-        emit processPercentage((int)50+50/3*(double)(x*width+y+1)/(height*width));
-        readANNpoint(queryPt, QColor(_raster.pixel(y, x)));
-
-        kdTree->annkSearch(queryPt, NEAREST_POINTS,
-                           nnIdx, dists, ERROR_BOUNDS);
-
-        if (dists[0] < _fcthres * _fcthres)
-        {
-            _raster.setPixel(y, x,
-                             qRgb(dataPts[nnIdx[0]][0],
-                                  dataPts[nnIdx[0]][1],
-                                  dataPts[nnIdx[0]][2]));
-            found[x*width+y] = '1';
-        }
-    }
-
-    // phase 2: find all case 2 pixels
-    emit statusUpdate(QString("Recolorization phase 2..."));
-    for (x = 0; x < height; x++) for (y = 0; y < width; y++) if (found.at(x*width+y) == '0')
-    {
-        emit processPercentage((int)50+50/3+1+50/3*(double)(x*width+y+1)/(height*width));
-        QColor target = search2(QPoint(x, y));
-        if (target.isValid())
-        {
-            _raster.setPixel(y, x, target.rgb());
-            found[x*width+y] = '2';
-        }
-    }
-
-    // phase 3: find all case 3 pixels
-    emit statusUpdate(QString("Recolorization phase 3..."));
-    for (x = 0; x < height; x++) for (y = 0; y < width; y++) if (found.at(x*width+y) == '0')
-    {
-        emit processPercentage((int)50+50/3*2+2+50/3*(double)(x*width+y+1)/(height*width));
-        QColor target = search3(QPoint(x, y));
-        if (target.isValid())
-        {
-            _raster.setPixel(y, x, target.rgb());
-            found[x*width+y] = '3';
-        }
-    }
-
-    // debug related
-    if (_debug)
-    {
-        debug_out.setDevice(&f_debug);
-        for (x = 0; x < height; x++)
-        {
-            for (y = 0; y < width; y++)
-                debug_out << found.at(x*width+y) << " ";
-            debug_out << endl;
-        }
-    }
-}
-
-// Re-rasterization related private function
-
-QColor RasterHandler::search2(QPoint p)
-{
-    // search, clean up
-    QList<QColor>* clist = search(p, 2);
-    if (clist->length() < 2) return QColor(_raster.pixel(p.y(), p.x()));
-    QColor t[3] = {clist->at(0), clist->at(1), QColor(_raster.pixel(p.y(), p.x()))};
-    delete clist;
-
-    // calc
-    double cp[3], ca[3], cb[3];
-    convertColorToVector(t[2], cp);
-    convertColorToVector(t[0], ca);
-    convertColorToVector(t[1], cb);
-
-    double ap[3], ab[3], sp[3];
-    vectorMinus(ap, cp, ca);
-    vectorMinus(ab, cb ,ca);
-    double wa = 1 - vectorDotProduct(ap, ab) / vectorDotProduct(ab);
-
-    // fitting error
-    double cs[3]={ca[0] * wa + cb[0] *  (1-wa),
-                  ca[1] * wa + cb[1] *  (1-wa),
-                  ca[2] * wa + cb[2] *  (1-wa)};
-    vectorMinus(sp, cp, cs);
-    double error = vectorDotProduct(sp);
-
-    if (error < _fcthres * _fcthres)
-        if (wa > 1 - wa) return t[0]; else return t[1];
-    else
-        return QColor();
-}
-
-QColor RasterHandler::search3(QPoint p)
-{
-    // search, clean up
-    QList<QColor>* clist = search(p, 3);
-    if (clist->length() < 3) return QColor(_raster.pixel(p.y(), p.x()));
-    QColor t[4] = {clist->at(0), clist->at(1), clist->at(2), QColor(_raster.pixel(p.y(), p.x()))};
-    delete clist;
-
-    // calc
-    double cp[3], ca[3], cb[3], cc[3];
-    convertColorToVector(t[3], cp);
-    convertColorToVector(t[0], ca);
-    convertColorToVector(t[1], cb);
-    convertColorToVector(t[2], cc);
-
-    double c[2][3];
-    double ac[3], bc[3], pc[3];
-    vectorMinus(ac, ca ,cc);
-    vectorMinus(bc, cb, cc);
-    vectorMinus(pc, cc, cp);
-    c[0][0] = vectorDotProduct(ac);
-    c[0][1] = vectorDotProduct(ac, bc);
-    c[0][2] = vectorDotProduct(pc, ac);
-    c[1][0] = c[0][1];
-    c[1][1] = vectorDotProduct(bc);
-    c[1][2] = vectorDotProduct(pc, bc);
-
-    if (c[0][1]*c[1][0] - c[0][0]*c[1][1] == 0) return t[3];
-    double w1 = (c[1][1]*c[0][2] - c[1][2]*c[0][1]) / (c[0][1]*c[1][0] - c[0][0]*c[1][1]);
-    double w2 = (c[1][2]*c[0][0] - c[0][2]*c[1][0]) / (c[0][1]*c[1][0] - c[0][0]*c[1][1]);
-    double w3 = 1 - w1 - w2;
-    if (w1 < 0 || w2 < 0 || w3 < 0) return t[3];
-
-    double cs[3] = {t[0].red()  *w1 +   t[1].red()      *   w2  +   t[2].red()  *   w3,
-                    t[0].green()*w1 +   t[1].green()    *   w2  +   t[2].green()*   w3,
-                    t[0].blue() *w1 +   t[1].blue()     *   w2  +   t[2].blue() *   w3};
-    double sp[3];
-    vectorMinus(sp, cp, cs);
-    double error = vectorDotProduct(sp);
-
-    if (error < _fcthres * _fcthres)
-    {
-        if (w1 > w2 && w1 > w3) return t[0];
-        if (w2 > w1 && w2 > w3) return t[1];
-        if (w3 > w1 && w3 > w1) return t[2];
-        return t[0];
-    }
-    else
-    {
-        // for debugging
-        if (_debug)
-        {
-            debug_out << "(" << t[3].red() << ' ' << t[3].green() << ' ' << t[3]. blue() <<
-                         ") (" << p.y() << ", " << p.x() << ")" << endl;
-            debug_out << "(" << t[0].red() << ' ' << t[0].green() << ' ' << t[0].blue() << ") " << w1 << endl;
-            debug_out << "(" << t[1].red() << ' ' << t[1].green() << ' ' << t[1].blue() << ") " << w2 << endl;
-            debug_out << "(" << t[2].red() << ' ' << t[2].green() << ' ' << t[2].blue() << ") " << w3 << endl;
-            debug_out << "(" << cs[0] << ' ' << cs[1] << ' ' << cs[2] << ") " << error << endl;
-            debug_out << endl;
-        }
-        return QColor();
-    }
-}
-
-bool RasterHandler::posJudge(QPoint p)
-{
-    return (p.x() > 0 && p.x() < _raster.height() && p.y() > 0 && p.y() < _raster.width());
-}
-
-QList<QColor>* RasterHandler::search(QPoint p, int num)
-{
-    const int dir[4][2] = {{1,0},{0,1},{-1,0},{0,-1}};
-    int i, o, j, k = 0;
-    QPoint c = p;
-    QList<QColor>* clist = new QList<QColor>;
-
-    for (i = 1; i <= _sdiam && num ; i++)
-        for (o = 0; o < 2 && num; o++)
-        {
-            for (j = 1; j <= i && num; j++)
-            {
-                c.rx() += dir[k%4][0];
-                c.ry() += dir[k%4][1];
-                if (posJudge(c) && found.at(c.x()*_raster.width()+c.y()) == '1' &&
-                        !clist->contains(_raster.pixel(c.y(), c.x())))
-                {
-                    clist->append(_raster.pixel(c.y(), c.x()));
-                    num--;
-                }
-            }
-            k++;
-        }
-    return clist;
-}
-
-void RasterHandler::convertColorToVector(QColor p, double *c)
-{
-    c[0] = p.red();
-    c[1] = p.green();
-    c[2] = p.blue();
-}
-
-// ANN related private functions
-
-void RasterHandler::readANNpoint(ANNpoint p, QColor c)
-{
-    p[0] = c.red();
-    p[1] = c.green();
-    p[2] = c.blue();
-}
-
-void RasterHandler::buildANNS()
-{
-    for (int i = 0; i < _c.length(); i++) readANNpoint(dataPts[i], _c[i]);
-
-    kdTree = new ANNkd_tree(dataPts, _c.length(), DIMENSIONS);
-}
-
-// Calculation related private function;
-
-void RasterHandler::vectorMinus(double *_dest, double* a, double* b)
-{
-    _dest[0] = a[0] - b[0];
-    _dest[1] = a[1] - b[1];
-    _dest[2] = a[2] - b[2];
-}
-
-double RasterHandler::vectorDotProduct(double* a) {return vectorDotProduct(a, a);}
-double RasterHandler::vectorDotProduct(double* a, double* b) {
-    return a[0]*b[0]+a[1]*b[1]+a[2]*b[2];
-}
-
-// clean things up
-
-RasterHandler::~RasterHandler()
-{
-    delete []nnIdx;
-    delete []dists;
-    annClose();
-}
+#include "rasterhandler.h"
+#include "parallel.h"
+#include <QElapsedTimer>
+
+RasterHandler::RasterHandler()
+{
+    //initialization
+
+    _loaded = false;
+    _rastered = false;
+    _debug = false;
+    _trace = NULL;
+    _rasterBits = NULL;
+    _rasterStride = 0;
+    _indexBytes = 1;
+    _cacheHits = _cacheMisses = 0;
+    _stale = STALE_PALETTE | STALE_NEAREST;
+    _cancel.store(0);
+    qRegisterMetaType<RasterStats>("RasterStats");
+
+    //default setting
+
+    _window = DEFAULT_WINDOW;
+    _cthres = DEFAULT_COLOR_THRESHOLD;
+    _fcthres = DEFAULT_FITTING_COLOR_THRESHOLD;
+    _sdiam = DEFAULT_SEARCH_DIAMETER;
+    _threads = QThread::idealThreadCount();
+
+}
+
+RasterHandler::RasterHandler(int window, double cthres, int sdiam, double fcthres) :
+    RasterHandler()
+{
+    setWindow(window);
+    setColorThreshold(cthres);
+    setSearchDiameter(sdiam);
+    setFittingColorThreshold(fcthres);
+}
+
+void RasterHandler::setDebugON()
+{
+    _debug = true;
+    p_debug.setFileName("output.debug");
+    f_debug.setFileName("found.map");
+}
+
+void RasterHandler::setOriginal(QString path)
+{
+    TraceScope trace(_trace, RasterStats::stageName(RasterStats::Load));
+    QElapsedTimer timer;
+    timer.start();
+    _stats.clear();
+    _rastered = false;
+    _stale = STALE_PALETTE | STALE_NEAREST;
+    _loaded = _original.load(path);
+    if (_loaded && (qint64)_original.width() * _original.height() > MAX_IMAGE_PIXELS)
+    {
+        _loaded = false;
+        _original = QImage();
+        emit statusUpdate(QString("Image too large, rasterize it as a stream."));
+    }
+
+    // every stage works on 32-bit scanlines, alpha is kept when present
+    if (_loaded)
+        _original = _original.convertToFormat(_original.hasAlphaChannel() ?
+                                                  QImage::Format_ARGB32 : QImage::Format_RGB32);
+    _stats.lap(RasterStats::Load, timer);
+    if (_loaded)
+        emit statusUpdate(QString("Image loaded."));
+}
+
+// only the shape color parameters invalidate cached stages, the
+// recolorization thresholds are applied on every run
+
+void RasterHandler::setWindow(int window)
+{
+    if (window != _window) _stale |= STALE_PALETTE;
+    _window = window;
+}
+
+void RasterHandler::setColorThreshold(double cthres)
+{
+    if (cthres != _cthres) _stale |= STALE_PALETTE;
+    _cthres = cthres;
+}
+
+void RasterHandler::setFittingColorThreshold (double fcthres) {_fcthres = fcthres;}
+void RasterHandler::setSearchDiameter(int sdiam) { _sdiam = sdiam;}
+void RasterHandler::setThreadCount(int threads) {_threads = qMax(1, threads);}
+
+// Records the stages of the following runs into `trace`, which has to
+// outlive them. NULL turns tracing off.
+
+void RasterHandler::setTrace(TraceRecorder *trace) {_trace = trace;}
+
+const QImage &RasterHandler::getOriginal() {return _original;}
+const QImage &RasterHandler::getRastered() {return _raster;}
+const ClassPlane &RasterHandler::getPixelClasses() {return found;}
+
+// The result as an 8-bit indexed image, or a null image when it holds more
+// than 256 distinct colors
+
+QImage RasterHandler::getRasteredIndexed()
+{
+    QHash<QRgb, int> lookup;
+    QVector<QRgb> table;
+    QImage indexed(_raster.width(), _raster.height(), QImage::Format_Indexed8);
+
+    for (int x = 0; x < _raster.height(); x++)
+    {
+        const QRgb *line = reinterpret_cast<const QRgb*>(_raster.constScanLine(x));
+        uchar *out = indexed.scanLine(x);
+        for (int y = 0; y < _raster.width(); y++)
+        {
+            int index = lookup.value(line[y], -1);
+            if (index < 0)
+            {
+                if (table.size() == 256) return QImage();
+                index = table.size();
+                lookup.insert(line[y], index);
+                table.append(line[y]);
+            }
+            out[y] = index;
+        }
+    }
+    indexed.setColorTable(table);
+    return indexed;
+}
+
+// PNG results that fit in a 256 color table are written indexed
+
+bool RasterHandler::saveRastered(QString path)
+{
+    TraceScope trace(_trace, RasterStats::stageName(RasterStats::Save));
+    QElapsedTimer timer;
+    QImage indexed;
+    timer.start();
+    if (QFileInfo(path).suffix().toLower() == QString("png"))
+        indexed = getRasteredIndexed();
+    bool saved = indexed.isNull() ? _raster.save(path) : indexed.save(path);
+    _stats.nsecs[RasterStats::Save] = timer.nsecsElapsed();
+    return saved;
+}
+int RasterHandler::getWindow() {return _window;}
+int RasterHandler::getSearchDiameter() {return _sdiam;}
+int RasterHandler::getThreadCount() {return _threads;}
+double RasterHandler::getColorThreshold() {return _cthres;}
+double RasterHandler::getFittingColorThreshold() {return _fcthres;}
+
+qint64 RasterHandler::getCacheHits() {return _cacheHits;}
+qint64 RasterHandler::getCacheMisses() {return _cacheMisses;}
+const RasterStats &RasterHandler::getStats() {return _stats;}
+
+bool RasterHandler::isLoaded() {return _loaded;}
+bool RasterHandler::isRastered() {return _rastered;}
+
+// Rasterization invoker
+
+void RasterHandler::raster()
+{
+    if (!_loaded) return;
+    traceBegin(_trace, "raster");
+    QElapsedTimer timer;
+    qint64 load = _stats.nsecs[RasterStats::Load];
+    _stats.clear();
+    _stats.nsecs[RasterStats::Load] = load;
+    _rastered = false;
+    prepareRaster();
+    if (_debug)
+    {
+        if (!p_debug.open(QIODevice::WriteOnly | QIODevice::Text))
+            _debug = false;
+        if (!f_debug.open(QIODevice::WriteOnly | QIODevice::Text))
+            _debug = false;
+        debug_out.setDevice(&p_debug);
+        debug_out.setRealNumberNotation(QTextStream::FixedNotation);
+        debug_out.setRealNumberPrecision(2);
+    }
+
+    emit processPercentage(0);
+    emit statusUpdate(QString("Start rastering..."));
+
+    // stages whose parameters did not change since the last run keep their
+    // results, a new palette invalidates the nearest color search and a
+    // cancelled stage stays stale
+    _stats.reused[RasterStats::ShapeColor] = !(_stale & STALE_PALETTE);
+    _stats.reused[RasterStats::BuildNearest] = !(_stale & STALE_NEAREST);
+    _stats.reused[RasterStats::NearestSearch] = !(_stale & STALE_NEAREST);
+    timer.start();
+    if (_stale & STALE_PALETTE && !isCancelled())
+    {
+        emit statusUpdate(QString("Start searching shape color..."));
+        _c.clear();
+        getShapeColor(NULL);
+        _stats.lap(RasterStats::ShapeColor, timer);
+        if (!isCancelled()) _stale = STALE_NEAREST;
+    }
+    if (_stale & STALE_NEAREST && !isCancelled())
+    {
+        buildNearest();
+        _stats.lap(RasterStats::BuildNearest, timer);
+        searchNearestColors();
+        _stats.lap(RasterStats::NearestSearch, timer);
+        if (!isCancelled()) _stale = 0;
+    }
+
+    if (!isCancelled()) recolorization();
+    _rastered = !isCancelled();
+    if (_rastered) countClasses(0, _raster.height());
+    _stats.paletteSize = _c.size();
+
+    if (_debug)
+    {
+        p_debug.close();
+        f_debug.close();
+    }
+    traceEnd(_trace, "raster");
+    emit processPercentage(0);
+    emit statusUpdate(QString(_rastered ? "Done." : "Cancelled."));
+    emit statsReady(_stats);
+    emit finished();
+}
+
+// Asks a running raster() to stop, safe to call from any thread. Every
+// stage polls the request once per row (or pixel chunk in phases 2 and 3)
+// and the run finishes without a result. The request stands until
+// resetCancel(), which the caller issues before starting the next run so
+// that a cancel sent while that run is starting up isn't lost.
+
+void RasterHandler::cancel() {_cancel.store(1);}
+
+void RasterHandler::resetCancel() {_cancel.store(0);}
+
+// Streaming variant of raster() for images too large to hold at once. The
+// source is read in bands of STREAM_BAND_ROWS rows twice: once to build the
+// palette and once to recolor, writing the result band by band. Palette
+// bands carry the windows accepted in their last _window - 1 rows over to
+// the next band, and recolorization bands are read with a halo of rows
+// wider than the search spiral, so the output is the one raster() gives.
+// Only the bands are kept in memory; the handler holds no image afterwards.
+
+bool RasterHandler::rasterStream(QString input, QString output)
+{
+    BandReader reader;
+    BandWriter writer;
+    bool debug = _debug, ok = false;
+
+    _rastered = _loaded = false;
+    _stale = STALE_PALETTE | STALE_NEAREST;
+    _debug = false;
+    _stats.clear();
+    traceBegin(_trace, "raster_stream");
+
+    emit processPercentage(0);
+    emit statusUpdate(QString("Start rastering..."));
+    if (reader.open(input))
+    {
+        ok = writer.open(output, reader.width(), reader.height(), reader.hasAlpha()) &&
+             streamBands(reader, writer);
+        ok = writer.close() && ok;
+    }
+
+    _debug = debug;
+    _loaded = false;
+    _original = _raster = QImage();
+    _rasterBits = NULL;
+    _nearestIndex.clear();
+    _nearestDist.clear();
+    _indexPlane.clear();
+    _stats.paletteSize = _c.size();
+    traceEnd(_trace, "raster_stream");
+    emit processPercentage(0);
+    emit statusUpdate(QString(ok ? "Done." : isCancelled() ? "Cancelled." : "Failed."));
+    emit statsReady(_stats);
+    emit finished();
+    return ok;
+}
+
+bool RasterHandler::streamBands(BandReader &reader, BandWriter &writer)
+{
+    int width = reader.width(), height = reader.height();
+    int positions = height - _window;
+    int band = qMax(STREAM_BAND_ROWS, _window);
+    int halo = _sdiam + 1;
+    int from, to;
+    QElapsedTimer timer;
+
+    if ((qint64)width * (band + 2 * qMax(halo, _window)) > MAX_IMAGE_PIXELS) return false;
+
+    // palette
+    emit statusUpdate(QString("Start searching shape color..."));
+    // reading bands counts as load time and writing them as save time
+    QVector<uchar> carry;
+    _c.clear();
+    timer.start();
+    for (from = 0; from < positions && !isCancelled(); from = to)
+    {
+        TraceScope trace(_trace, "palette_band", from / band);
+        to = qMin(positions, from + band);
+        _original = reader.read(from, to - from + _window);
+        _stats.lap(RasterStats::Load, timer);
+        if (_original.isNull()) return false;
+        getShapeColor(&carry);
+        _stats.lap(RasterStats::ShapeColor, timer);
+    }
+    if (isCancelled()) return false;
+
+    // recolorization
+    qint64 hits = 0, misses = 0;
+    bool ok = true;
+    buildNearest();
+    _stats.lap(RasterStats::BuildNearest, timer);
+    for (from = 0; ok && from < height && !isCancelled(); from = to)
+    {
+        TraceScope trace(_trace, "raster_band", from / band);
+        to = qMin(height, from + band);
+        int top = qMax(0, from - halo), bottom = qMin(height, to + halo);
+        emit statusUpdate(QString("Rastering rows ") + QString::number(from) + QString(" to ") +
+                          QString::number(to - 1) + QString("..."));
+        _original = reader.read(top, bottom - top);
+        _stats.lap(RasterStats::Load, timer);
+        if (_original.isNull()) ok = false;
+        if (!ok) break;
+
+        prepareRaster();
+        searchNearestColors();
+        _stats.lap(RasterStats::NearestSearch, timer);
+        hits += _cacheHits;
+        misses += _cacheMisses;
+        recolorization();
+        timer.start();
+        ok = !isCancelled() && writer.write(_raster, from - top, to - from);
+        if (ok) countClasses(from - top, to - top);
+        _stats.lap(RasterStats::Save, timer);
+    }
+    _cacheHits = hits;
+    _cacheMisses = misses;
+    return ok;
+}
+
+// Raster related private function
+
+// Starts the result as a copy of the source with every pixel unresolved
+
+void RasterHandler::prepareRaster()
+{
+    _raster = _original.copy();
+    _rasterBits = reinterpret_cast<QRgb*>(_raster.bits());
+    _rasterStride = _raster.bytesPerLine() / sizeof(QRgb);
+    found.reset(_original.width() * _original.height());
+}
+
+// Adds the colors of the shape windows of _original to the palette. When
+// _original is a band of a larger image, `carry` brings in the SHAPE_ACCEPTED
+// flags of the _window - 1 window rows above it (empty for the first band)
+// and is updated for the next band.
+
+void RasterHandler::getShapeColor(QVector<uchar> *carry)
+{
+    int rows = _original.height() - _window;
+    int cols = _original.width() - _window;
+    int x, y;
+
+    if (rows <= 0 || cols <= 0) return;
+    TraceScope trace(_trace, RasterStats::stageName(RasterStats::ShapeColor));
+
+    // window positions are split into row bands that are scanned in parallel,
+    // each one starting from an empty coverage table
+    int bands = 1;
+    if (_threads > 1)
+        bands = qBound(1, rows / (SHAPE_BAND_WINDOWS * _window), _threads * SHAPE_BANDS_PER_THREAD);
+
+    QVector<uchar> state(rows * cols);
+    uchar *plane = state.data();
+    _progress.start(0, 45, rows);
+    parallelFor(bands, _threads, [&](int b)
+    {
+        TraceScope trace(_trace, "shape_band", b);
+        int from = rows * b / bands, to = rows * (b + 1) / bands;
+        QVector<uchar> table((to - from + _window - 1) * cols);
+        WindowBounds bounds;
+        bounds.compute(_original, _window, from, to, cols);
+        if (b == 0 && carry && !carry->isEmpty())
+            for (x = 0; x < _window - 1; x++) for (y = 0; y < cols; y++)
+                if (carry->at(x * cols + y))
+                    markShapeWindow(x - _window + 1, y, table.data(), to - from + _window - 1);
+        coverShapeRows(from, to, table.data(), plane, &bounds);
+    });
+
+    // a band only misses the coverage spilling over from the windows accepted
+    // in the last _window - 1 rows above it, so its top rows are rescanned in
+    // order until they agree with the first pass again
+    for (int b = 1; b < bands && _window > 1; b++)
+    {
+        TraceScope trace(_trace, "shape_repair", b);
+        int from = rows * b / bands, to = rows * (b + 1) / bands;
+        QVector<uchar> table((to - from + _window - 1) * cols);
+        for (x = qMax(0, from - _window + 1); x < from; x++) for (y = 0; y < cols; y++)
+            if (plane[x * cols + y] & SHAPE_ACCEPTED)
+                markShapeWindow(x - from, y, table.data(), to - from + _window - 1);
+        coverShapeRows(from, to, table.data(), plane, NULL);
+    }
+    emit processPercentage(48);
+
+    // collect the colors of the accepted windows band by band, then merge in
+    // band order so the palette order is the one of a serial row-major scan
+    QVector<ColorPalette> colors(bands);
+    ColorPalette *bandColors = colors.data();
+    parallelFor(bands, _threads, [&](int b)
+    {
+        TraceScope trace(_trace, "shape_colors", b);
+        for (int i = rows * b / bands; i < rows * (b + 1) / bands && !isCancelled(); i++)
+        {
+            const QRgb *line = originalLine(i);
+            for (int j = 0; j < cols; j++) if (plane[i * cols + j] & SHAPE_ACCEPTED)
+                bandColors[b].insert(line[j]);
+        }
+    });
+
+    for (int b = 0; b < bands; b++) for (int i = 0; i < colors.at(b).size(); i++)
+        _c.insert(colors.at(b).at(i));
+
+    // the last _window - 1 window rows, reaching back into the old carry
+    // when this band is shorter than that
+    if (carry)
+    {
+        QVector<uchar> next((_window - 1) * cols);
+        for (x = 0; x < _window - 1; x++)
+        {
+            int row = rows - _window + 1 + x;
+            if (row < 0 && carry->isEmpty()) continue;
+            const uchar *src = row >= 0 ? plane + row * cols : carry->constData() + (row + _window - 1) * cols;
+            for (y = 0; y < cols; y++) next[x * cols + y] = src[y] & SHAPE_ACCEPTED;
+        }
+        carry->swap(next);
+    }
+    emit processPercentage(50);
+}
+
+// Greedy shape window selection over window rows [from, to). `table` holds
+// the coverage of rows from .. to + _window - 2. Without `bounds` this is a
+// repair scan, which stops once _window - 1 consecutive rows match the
+// previous result since everything below only depends on those rows.
+
+void RasterHandler::coverShapeRows(int from, int to, uchar *table, uchar *state,
+                                   const WindowBounds *bounds)
+{
+    int cols = _original.width() - _window;
+    int tableRows = to - from + _window - 1;
+    int matching = 0;
+
+    for (int x = from; x < to && !isCancelled(); x++)
+    {
+        uchar *s = state + x * cols;
+        uchar *t = table + (x - from) * cols;
+        bool same = true;
+        for (int y = 0; y < cols; y++)
+        {
+            uchar was = s[y] & SHAPE_ACCEPTED;
+            s[y] &= ~SHAPE_ACCEPTED;
+            if (!t[y])
+            {
+                if (!(s[y] & SHAPE_TESTED))
+                    s[y] |= SHAPE_TESTED | (isUniformWindow(x, y, bounds) ? SHAPE_UNIFORM : 0);
+                if (s[y] & SHAPE_UNIFORM)
+                {
+                    s[y] |= SHAPE_ACCEPTED;
+                    markShapeWindow(x - from, y, table, tableRows);
+                }
+            }
+            if ((s[y] & SHAPE_ACCEPTED) != was) same = false;
+        }
+        if (bounds)
+        {
+            reportProgress(1);
+            continue;
+        }
+        matching = same ? matching + 1 : 0;
+        if (matching >= _window - 1) return;
+    }
+}
+
+void RasterHandler::markShapeWindow(int x, int y, uchar *table, int tableRows)
+{
+    int cols = _original.width() - _window;
+    for (int i = qMax(0, x); i < x + _window && i < tableRows; i++)
+        for (int j = y; j < y + _window && j < cols; j++)
+            table[i * cols + j] = 1;
+}
+
+// The channel bounds settle most windows, only those whose spread straddles
+// the threshold fall back to checking every pixel.
+
+bool RasterHandler::isUniformWindow(int x, int y, const WindowBounds *bounds)
+{
+    QRgb seed = originalLine(x)[y];
+    if (bounds)
+    {
+        int lower, upper;
+        bounds->distanceBounds(x, y, seed, lower, upper);
+        if (upper <= _cthres * _cthres) return true;
+        if (lower > _cthres * _cthres) return false;
+    }
+
+    for (int i = 0; i < _window; i++)
+    {
+        const QRgb *line = originalLine(x + i) + y;
+        for (int j = 0; j < _window; j++)
+            if (colorDistance(line[j], seed) > _cthres * _cthres) return false;
+    }
+    return true;
+}
+
+// Nearest palette color and its squared distance for every source pixel,
+// kept until the palette changes so that a new _fcthres only re-thresholds
+// them. Row blocks run in parallel, each with its own color cache so every
+// distinct color is searched once per block.
+
+void RasterHandler::searchNearestColors()
+{
+    int width = _original.width();
+    int height = _original.height();
+    TraceScope trace(_trace, RasterStats::stageName(RasterStats::NearestSearch));
+
+    emit statusUpdate(QString("Searching nearest colors..."));
+    _nearestIndex.resize(width * height);
+    _nearestDist.resize(width * height);
+    int *nearestIndex = _nearestIndex.data();
+    int *nearestDist = _nearestDist.data();
+
+    int blocks = qMin(_threads, height);
+    QVector<ColorCache> caches(blocks);
+    ColorCache *cache = caches.data();
+    _progress.start(50, 50+50/3, height);
+    parallelFor(blocks, _threads, [&](int b)
+    {
+        TraceScope trace(_trace, "nearest_block", b);
+
+        for (int x = height * b / blocks; x < height * (b + 1) / blocks && !isCancelled(); x++)
+        {
+            const QRgb *line = originalLine(x);
+            for (int y = 0; y < width; y++)
+            {
+                int index, dist;
+                if (!cache[b].lookup(line[y], index, dist))
+                {
+                    index = _nearest.nearest(line[y], dist);
+                    cache[b].insert(line[y], index, dist);
+                }
+                nearestIndex[x*width+y] = index;
+                nearestDist[x*width+y] = dist;
+            }
+            reportProgress(1);
+        }
+    });
+
+    _cacheHits = _cacheMisses = 0;
+    for (int b = 0; b < blocks; b++)
+    {
+        _cacheHits += caches.at(b).hits();
+        _cacheMisses += caches.at(b).misses();
+    }
+    _stats.nearestQueries += _cacheMisses;
+    if (_nearest.usesGrid()) _stats.gridQueries += _cacheMisses;
+}
+
+void RasterHandler::recolorization()
+{
+    int width = _raster.width();
+    int height = _raster.height();
+    int x,y;
+    QElapsedTimer timer;
+    timer.start();
+
+    // phase 1 : find all case 1 pixels, only a threshold on the cached
+    // nearest color search
+    emit statusUpdate(QString("Recolorization phase 1..."));
+    traceBegin(_trace, RasterStats::stageName(RasterStats::Phase1));
+    int blocks = qMin(_threads, height);
+    const int *nearestIndex = _nearestIndex.constData();
+    const int *nearestDist = _nearestDist.constData();
+    _indexBytes = _c.size() < 0xff ? 1 : _c.size() < 0xffff ? 2 : 4;
+    _indexPlane.resize(width * height * _indexBytes);
+    parallelFor(blocks, _threads, [&](int b)
+    {
+        TraceScope trace(_trace, "phase1_block", b);
+        for (int x = height * b / blocks; x < height * (b + 1) / blocks && !isCancelled(); x++)
+        {
+            QRgb *line = rasterLine(x);
+            for (int y = 0; y < width; y++)
+            {
+                int i = x*width+y;
+                if (nearestIndex[i] >= 0 && nearestDist[i] < _fcthres * _fcthres)
+                {
+                    line[y] = _c.at(nearestIndex[i]) | 0xff000000;
+                    found.set(i, ClassPlane::Phase1);
+                }
+            }
+        }
+        if (_indexBytes == 1)
+            fillIndexPlane<quint8>(height * b / blocks, height * (b + 1) / blocks);
+        else if (_indexBytes == 2)
+            fillIndexPlane<quint16>(height * b / blocks, height * (b + 1) / blocks);
+        else
+            fillIndexPlane<quint32>(height * b / blocks, height * (b + 1) / blocks);
+    });
+    emit processPercentage(50+50/3);
+    traceEnd(_trace, RasterStats::stageName(RasterStats::Phase1));
+    _stats.lap(RasterStats::Phase1, timer);
+    if (isCancelled()) return;
+
+    // phases 2 and 3 only visit what the previous phase left unresolved.
+    // Their searches read the index plane, which only holds phase 1 pixels,
+    // so the pixels they resolve never feed back into each other
+    traceBegin(_trace, "search_setup");
+    buildSpiral();
+    QVector<int> pending = unresolvedPixels();
+    if (_sdiam >= NEIGHBOR_FIELD_DIAMETER && !pending.isEmpty())
+        _field.build(found, _rasterBits, _rasterStride, width, height, _spiralReach);
+    else
+        _field.clear();
+    traceEnd(_trace, "search_setup");
+
+    // phase 2: find all case 2 pixels
+    emit statusUpdate(QString("Recolorization phase 2..."));
+    pending = resolvePixels(pending, ClassPlane::Phase2, 50+50/3+1);
+    _stats.lap(RasterStats::Phase2, timer);
+    if (isCancelled())
+    {
+        _field.clear();
+        return;
+    }
+
+    // phase 3: find all case 3 pixels
+    emit statusUpdate(QString("Recolorization phase 3..."));
+    pending = resolvePixels(pending, ClassPlane::Phase3, 50+50/3*2+2);
+    _field.clear();
+    _stats.lap(RasterStats::Phase3, timer);
+
+    // debug related
+    if (_debug)
+    {
+        debug_out.setDevice(&f_debug);
+        for (x = 0; x < height; x++)
+        {
+            for (y = 0; y < width; y++)
+                debug_out << char('0' + found.at(x*width+y)) << " ";
+            debug_out << endl;
+        }
+    }
+}
+
+// Runs the phase 2 or phase 3 search over `pending` in parallel chunks and
+// returns the pixels still unresolved, in their original order. Debug runs
+// stay serial to keep output.debug in order.
+
+QVector<int> RasterHandler::resolvePixels(const QVector<int> &pending,
+                                          ClassPlane::PixelClass phase, int progress)
+{
+    int width = _raster.width();
+    int threads = _debug ? 1 : _threads;
+    bool phase2 = phase == ClassPlane::Phase2;
+    TraceScope trace(_trace, RasterStats::stageName(phase2 ? RasterStats::Phase2 : RasterStats::Phase3));
+    int chunks = qBound(1, pending.size() / RESOLVE_CHUNK_PIXELS, threads * RESOLVE_CHUNKS_PER_THREAD);
+    QVector<QVector<int> > left(chunks);
+    QVector<int> *chunkLeft = left.data();
+    QVector<qint64> steps(chunks);
+    qint64 *chunkSteps = steps.data();
+
+    // progress and cancellation are handled once per image row worth of
+    // pixels
+    _progress.start(progress, progress + 50/3, pending.size());
+    parallelFor(chunks, threads, [&](int c)
+    {
+        TraceScope trace(_trace, phase2 ? "phase2_chunk" : "phase3_chunk", c);
+        int from = (qint64)pending.size() * c / chunks;
+        int to = (qint64)pending.size() * (c + 1) / chunks;
+        TriangleCache triangles;
+        qint64 visited = 0;
+        for (int i = from; i < to; i++)
+        {
+            if ((i - from) % width == 0 && i > from)
+            {
+                reportProgress(width);
+                if (isCancelled()) break;
+            }
+            int x = pending.at(i) / width, y = pending.at(i) % width;
+            QRgb target;
+            bool resolved = phase2 ? search2(QPoint(x, y), target, visited)
+                                   : search3(QPoint(x, y), target, triangles, visited);
+            if (resolved)
+            {
+                rasterLine(x)[y] = target;
+                found.set(pending.at(i), phase);
+            }
+            else
+                chunkLeft[c].append(pending.at(i));
+        }
+        chunkSteps[c] = visited;
+        if (!isCancelled()) reportProgress((to - from - 1) % width + 1);
+    });
+
+    QVector<int> remaining;
+    for (int c = 0; c < chunks; c++)
+    {
+        remaining += left.at(c);
+        _stats.searchSteps += steps.at(c);
+    }
+    return remaining;
+}
+
+void RasterHandler::reportProgress(qint64 units)
+{
+    int percent = _progress.advance(units);
+    if (percent >= 0) emit processPercentage(percent);
+}
+
+// Linear indices of the pixels phase 1 left unresolved, collected with the
+// span-skipping scan of the classification plane.
+
+QVector<int> RasterHandler::unresolvedPixels()
+{
+    QVector<int> pixels;
+    int size = found.size();
+    for (int i = found.nextUnresolved(0, size); i < size; i = found.nextUnresolved(i + 1, size))
+        pixels.append(i);
+    return pixels;
+}
+
+// Re-rasterization related private function
+// Both searches report the pixel they fall back to with full alpha, as the
+// color returned by QColor::rgb() used to. Unresolved pixels still hold
+// their source color, so it is read from _original; neighbors only count
+// when phase 1 resolved them, and those raster pixels are never written
+// again. This keeps the searches free of races with concurrent writers.
+
+bool RasterHandler::search2(QPoint p, QRgb &target, qint64 &steps)
+{
+    // search
+    NeighborColors clist = search(p, 2);
+    steps += clist.steps;
+    if (clist.size < 2)
+    {
+        target = originalLine(p.x())[p.y()] | 0xff000000;
+        return true;
+    }
+    QRgb t[3] = {_c.at(clist.at[0]) | 0xff000000, _c.at(clist.at[1]) | 0xff000000,
+                 originalLine(p.x())[p.y()]};
+
+    // calc: p projects onto ab at ap.ab / |ab|^2, which leaves a fitting
+    // error of |ap|^2 - (ap.ab)^2 / |ab|^2. Scaled by |ab|^2 it stays exact
+    // in integers, and a is the closer end while 2 ap.ab < |ab|^2.
+    qint64 ab2 = colorDot(t[0], t[1], t[0], t[1]);
+    qint64 apab = colorDot(t[0], t[2], t[0], t[1]);
+    qint64 error = colorDot(t[0], t[2], t[0], t[2]) * ab2 - apab * apab;
+
+    if (error < _fcthres * _fcthres * ab2)
+    {
+        if (2 * apab < ab2) target = t[0]; else target = t[1];
+        return true;
+    }
+    else
+        return false;
+}
+
+bool RasterHandler::search3(QPoint p, QRgb &target, TriangleCache &triangles, qint64 &steps)
+{
+    // search
+    NeighborColors clist = search(p, 3);
+    steps += clist.steps;
+    if (clist.size < 3)
+    {
+        target = originalLine(p.x())[p.y()] | 0xff000000;
+        return true;
+    }
+    QRgb t[4] = {_c.at(clist.at[0]) | 0xff000000, _c.at(clist.at[1]) | 0xff000000,
+                 _c.at(clist.at[2]) | 0xff000000, originalLine(p.x())[p.y()]};
+
+    // calc: the edges ac, bc only depend on the palette triple, the cache
+    // keeps their Gram matrix. Every entry is an integer, so the solve
+    // below sees the same doubles as when they are computed in place.
+    TriangleCache::Triangle g = triangles.lookup(clist.at[0], clist.at[1], clist.at[2],
+                                                 t[0], t[1], t[2]);
+    double cp[3];
+    convertColorToVector(t[3], cp);
+
+    double c[2][3];
+    c[0][0] = g.c00;
+    c[0][1] = g.c01;
+    c[0][2] = colorDot(t[3], t[2], t[2], t[0]);
+    c[1][0] = c[0][1];
+    c[1][1] = g.c11;
+    c[1][2] = colorDot(t[3], t[2], t[2], t[1]);
+
+    target = t[3] | 0xff000000;
+    if (g.det == 0) return true;
+    double det = g.det;
+    double w1 = (c[1][1]*c[0][2] - c[1][2]*c[0][1]) / det;
+    double w2 = (c[1][2]*c[0][0] - c[0][2]*c[1][0]) / det;
+    double w3 = 1 - w1 - w2;
+    if (w1 < 0 || w2 < 0 || w3 < 0) return true;
+
+    double cs[3] = {qRed(t[0])  *w1 +   qRed(t[1])      *   w2  +   qRed(t[2])  *   w3,
+                    qGreen(t[0])*w1 +   qGreen(t[1])    *   w2  +   qGreen(t[2])*   w3,
+                    qBlue(t[0]) *w1 +   qBlue(t[1])     *   w2  +   qBlue(t[2]) *   w3};
+    double sp[3];
+    vectorMinus(sp, cp, cs);
+    double error = vectorDotProduct(sp);
+
+    if (error < _fcthres * _fcthres)
+    {
+        if (w1 > w2 && w1 > w3) target = t[0];
+        else if (w2 > w1 && w2 > w3) target = t[1];
+        else if (w3 > w1 && w3 > w1) target = t[2];
+        else target = t[0];
+        return true;
+    }
+    else
+    {
+        // for debugging
+        if (_debug)
+        {
+            debug_out << "(" << qRed(t[3]) << ' ' << qGreen(t[3]) << ' ' << qBlue(t[3]) <<
+                         ") (" << p.y() << ", " << p.x() << ")" << endl;
+            debug_out << "(" << qRed(t[0]) << ' ' << qGreen(t[0]) << ' ' << qBlue(t[0]) << ") " << w1 << endl;
+            debug_out << "(" << qRed(t[1]) << ' ' << qGreen(t[1]) << ' ' << qBlue(t[1]) << ") " << w2 << endl;
+            debug_out << "(" << qRed(t[2]) << ' ' << qGreen(t[2]) << ' ' << qBlue(t[2]) << ") " << w3 << endl;
+            debug_out << "(" << cs[0] << ' ' << cs[1] << ' ' << cs[2] << ") " << error << endl;
+            debug_out << endl;
+        }
+        return false;
+    }
+}
+
+bool RasterHandler::posJudge(QPoint p)
+{
+    return (p.x() > 0 && p.x() < _raster.height() && p.y() > 0 && p.y() < _raster.width());
+}
+
+// Lays out the square spiral walked by search() for the current _sdiam and
+// image width, so every query only replays the table. The spiral never
+// steps back to an inner Chebyshev ring, _spiralRing holds where each ring
+// starts.
+
+void RasterHandler::buildSpiral()
+{
+    const int dir[4][2] = {{1,0},{0,1},{-1,0},{0,-1}};
+    int i, o, j, k = 0;
+    int dx = 0, dy = 0;
+
+    _spiral.clear();
+    _spiral.reserve(_sdiam * (_sdiam + 1));
+    _spiralRing.fill(0, 1);
+    _spiralReach = 0;
+    for (i = 1; i <= _sdiam; i++)
+        for (o = 0; o < 2; o++)
+        {
+            for (j = 1; j <= i; j++)
+            {
+                dx += dir[k%4][0];
+                dy += dir[k%4][1];
+                SpiralStep s = {dx, dy, dx * _raster.width() + dy};
+                _spiral.append(s);
+                _spiralReach = qMax(_spiralReach, qMax(qAbs(dx), qAbs(dy)));
+                while (_spiralRing.size() <= _spiralReach) _spiralRing.append(_spiral.size() - 1);
+            }
+            k++;
+        }
+    _spiralRing.append(_spiral.size());
+}
+
+// Palette index of every phase 1 pixel in rows [from, to), all ones for
+// the others. The plane is as narrow as the palette allows, and lets
+// search() compare indices instead of reading colors from the raster.
+
+template <typename T>
+void RasterHandler::fillIndexPlane(int from, int to)
+{
+    T *plane = reinterpret_cast<T*>(_indexPlane.data());
+    const int *nearestIndex = _nearestIndex.constData();
+    for (int i = from * _raster.width(); i < to * _raster.width(); i++)
+        plane[i] = found.at(i) == ClassPlane::Phase1 ? T(nearestIndex[i]) : T(-1);
+}
+
+// Pixels at least _spiralReach away from the border skip posJudge(). With
+// a neighbor field the walk starts at the ring of the nearest phase 1
+// pixel, and is not taken at all when it can't find `num` colors.
+
+NeighborColors RasterHandler::search(QPoint p, int num)
+{
+    if (_indexBytes == 1) return searchIndexed<quint8>(p, num);
+    if (_indexBytes == 2) return searchIndexed<quint16>(p, num);
+    return searchIndexed<quint32>(p, num);
+}
+
+template <typename T>
+NeighborColors RasterHandler::searchIndexed(QPoint p, int num)
+{
+    const T *plane = reinterpret_cast<const T*>(_indexPlane.constData());
+    int x = p.x(), y = p.y();
+    int base = x * _raster.width() + y;
+    bool interior = x > _spiralReach && x < _raster.height() - _spiralReach &&
+                    y > _spiralReach && y < _raster.width() - _spiralReach;
+    const SpiralStep *s = _spiral.constData(), *end = s + _spiral.size();
+    NeighborColors clist;
+
+    clist.size = clist.steps = 0;
+    num = qMin(num, SEARCH_COLORS);
+    if (!_field.isEmpty())
+    {
+        if (_field.count(base) < num) return clist;
+        s += _spiralRing.at(_field.distance(base, 0));
+    }
+    const SpiralStep *first = s;
+    for (; s != end && num; s++)
+    {
+        if (!interior && !posJudge(QPoint(x + s->dx, y + s->dy))) continue;
+        T index = plane[base + s->offset];
+        if (index == T(-1) || clist.contains(index)) continue;
+        clist.at[clist.size++] = index;
+        num--;
+    }
+    clist.steps = s - first;
+    return clist;
+}
+
+void RasterHandler::convertColorToVector(QRgb p, double *c)
+{
+    c[0] = qRed(p);
+    c[1] = qGreen(p);
+    c[2] = qBlue(p);
+}
+
+// Adds rows [from, to) of the last recolorization to the pixel and class
+// counts, streamed bands count their own rows but not the halo
+
+void RasterHandler::countClasses(int from, int to)
+{
+    int width = _raster.width();
+    _stats.pixels += (qint64)width * (to - from);
+    for (int i = from * width; i < to * width; i++) _stats.resolved[found.at(i)]++;
+}
+
+// Nearest color related private functions
+
+void RasterHandler::buildNearest()
+{
+    TraceScope trace(_trace, RasterStats::stageName(RasterStats::BuildNearest));
+    _nearest.build(_c);
+}
+
+// Calculation related private function;
+
+void RasterHandler::vectorMinus(double *_dest, double* a, double* b)
+{
+    _dest[0] = a[0] - b[0];
+    _dest[1] = a[1] - b[1];
+    _dest[2] = a[2] - b[2];
+}
+
+double RasterHandler::vectorDotProduct(double* a) {return vectorDotProduct(a, a);}
+double RasterHandler::vectorDotProduct(double* a, double* b) {
+    return a[0]*b[0]+a[1]*b[1]+a[2]*b[2];
+}
+
+// clean things up
+
+RasterHandler::~RasterHandler() {}
@@ -1,91 +1,195 @@
-#ifndef RASTERHANDLER_H
-#define RASTERHANDLER_H
-
-#define DEFAULT_WINDOW 3
-#define DEFAULT_COLOR_THRESHOLD 1
-#define DEFAULT_FITTING_COLOR_THRESHOLD 3
-#define DEFAULT_SEARCH_DIAMETER 7
-#define DIMENSIONS 3
-#define MAX_COLORS 5000000
-#define MAX_PIXELS 5000
-#define NEAREST_POINTS 1
-#define ERROR_BOUNDS 0
-
-#include <QtGui/QImage>
-#include <QtGui/QColor>
-#include <QFile>
-#include <QTextStream>
-#include <ANN/ANN.h>
-
-class RasterHandler : public QObject
-{
-    Q_OBJECT
-
-public:
-    RasterHandler();
-    RasterHandler(int, double , int, double fcthres);
-    ~RasterHandler();
-    void setOriginal(QString);
-    void setWindow(int);
-    void setColorThreshold(double);
-    void setFittingColorThreshold(double);
-    void setDebugON();
-    void setSearchDiameter(int);
-    const QImage &getOriginal();
-    const QImage &getRastered();
-    int getWindow();
-    int getSearchDiameter();
-    double getColorThreshold();
-    double getFittingColorThreshold();
-    bool isLoaded();
-    bool isRastered();
-
-private:
-
-    // private parameters & flags
-    QImage _original, _raster;
-    bool _rastered, _loaded, _debug;
-    QByteArray found;
-    int _window, _sdiam;
-    double _cthres, _fcthres;
-    QList<QColor> _c;
-
-    // ANN related
-    void buildANNS();
-    void readANNpoint(ANNpoint, QColor);
-    ANNpointArray dataPts;
-    ANNpoint queryPt;
-    ANNidxArray nnIdx;
-    ANNdistArray dists;
-    ANNkd_tree* kdTree;
-
-    // debugging files
-    QFile p_debug, f_debug;
-    QTextStream debug_out;
-
-    // rasterization related
-    QList<QColor> *search(QPoint, int);
-    QColor search2(QPoint);
-    QColor search3(QPoint);
-    bool posJudge(QPoint);
-
-    // calculation related
-    void convertColorToVector(QColor, double*);
-    void vectorMinus(double*, double*, double*);
-    double vectorDotProduct(double*);
-    double vectorDotProduct(double*, double*);
-
-    // main step
-    void getShapeColor();
-    void recolorization();
-
-signals:
-    void processPercentage(int);
-    void statusUpdate(QString);
-    void finished();
-
-public slots:
-    void raster();
-};
-
-#endif // RASTERHANDLER_H
+#ifndef RASTERHANDLER_H
+#define RASTERHANDLER_H
+
+#define DEFAULT_WINDOW 3
+#define DEFAULT_COLOR_THRESHOLD 1
+#define DEFAULT_FITTING_COLOR_THRESHOLD 3
+#define DEFAULT_SEARCH_DIAMETER 7
+// the neighbor field keeps NEIGHBOR_COLORS colors per pixel in one QVector,
+// which Qt caps at INT_MAX bytes with its header; larger images have to be
+// streamed
+#define MAX_IMAGE_PIXELS ((INT_MAX - 64) / (NEIGHBOR_COLORS * (int)sizeof(QRgb)))
+#define SEARCH_COLORS 3
+
+// getShapeColor() scans bands of at least SHAPE_BAND_WINDOWS windows height,
+// SHAPE_BANDS_PER_THREAD of them per thread for load balancing
+#define SHAPE_BAND_WINDOWS 8
+#define SHAPE_BANDS_PER_THREAD 4
+#define SHAPE_TESTED 0x1
+#define SHAPE_UNIFORM 0x2
+#define SHAPE_ACCEPTED 0x4
+
+// raster() reruns only the stages marked stale since the last run
+#define STALE_PALETTE 0x1
+#define STALE_NEAREST 0x2
+
+// phases 2 and 3 hand out chunks of at least RESOLVE_CHUNK_PIXELS pixels
+#define RESOLVE_CHUNK_PIXELS 256
+#define RESOLVE_CHUNKS_PER_THREAD 4
+
+// rasterStream() reads and writes bands of STREAM_BAND_ROWS rows
+#define STREAM_BAND_ROWS 256
+
+// from this search diameter on, phases 2 and 3 prune the spiral with a
+// NeighborField instead of walking it from the center
+#define NEIGHBOR_FIELD_DIAMETER 10
+
+#include <climits>
+#include <QtGui/QImage>
+#include <QtGui/QColor>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QTextStream>
+#include <QMutex>
+#include <QThread>
+#include <QAtomicInt>
+#include <QVector>
+#include "colorpalette.h"
+#include "windowbounds.h"
+#include "nearestcolor.h"
+#include "colorcache.h"
+#include "classplane.h"
+#include "neighborfield.h"
+#include "progressreporter.h"
+#include "bandio.h"
+#include "colormath.h"
+#include "trianglecache.h"
+#include "rasterstats.h"
+#include "tracerecorder.h"
+
+// one step of the search() spiral, `offset` is dx * width + dy
+struct SpiralStep
+{
+    int dx, dy, offset;
+};
+
+// the palette indices of the distinct colors found by search(), kept on
+// the stack, and the spiral steps it took to find them
+struct NeighborColors
+{
+    int at[SEARCH_COLORS];
+    int size, steps;
+
+    inline bool contains(int c) const
+    {
+        for (int i = 0; i < size; i++) if (at[i] == c) return true;
+        return false;
+    }
+};
+
+class RasterHandler : public QObject
+{
+    Q_OBJECT
+
+public:
+    RasterHandler();
+    RasterHandler(int, double , int, double fcthres);
+    ~RasterHandler();
+    void setOriginal(QString);
+    void setWindow(int);
+    void setColorThreshold(double);
+    void setFittingColorThreshold(double);
+    void setDebugON();
+    void setSearchDiameter(int);
+    void setThreadCount(int);
+    void setTrace(TraceRecorder *);
+    const QImage &getOriginal();
+    const QImage &getRastered();
+    const ClassPlane &getPixelClasses();
+    QImage getRasteredIndexed();
+    bool saveRastered(QString);
+    int getWindow();
+    int getSearchDiameter();
+    int getThreadCount();
+    double getColorThreshold();
+    double getFittingColorThreshold();
+    qint64 getCacheHits();
+    qint64 getCacheMisses();
+    const RasterStats &getStats();
+    void cancel();
+    void resetCancel();
+    bool rasterStream(QString, QString);
+    inline bool isCancelled() const {return _cancel.load() != 0;}
+    bool isLoaded();
+    bool isRastered();
+
+private:
+    friend class StageBenchmark;
+
+    // private parameters & flags
+    QImage _original, _raster;
+    QRgb *_rasterBits;          // detached once per run, shared by workers
+    int _rasterStride;
+    bool _rastered, _loaded, _debug;
+    ClassPlane found;
+    int _window, _sdiam, _threads;
+    double _cthres, _fcthres;
+    ColorPalette _c;
+
+    // nearest color related
+    void buildNearest();
+    NearestColor _nearest;
+    qint64 _cacheHits, _cacheMisses;
+    QVector<int> _nearestIndex, _nearestDist;
+    int _stale;
+    QAtomicInt _cancel;
+    ProgressReporter _progress;
+    RasterStats _stats;
+    TraceRecorder *_trace;      // not owned, NULL unless tracing
+    void reportProgress(qint64);
+
+    // debugging files
+    QFile p_debug, f_debug;
+    QTextStream debug_out;
+
+    // rasterization related
+    NeighborColors search(QPoint, int);
+    template <typename T> NeighborColors searchIndexed(QPoint, int);
+    template <typename T> void fillIndexPlane(int, int);
+    QVector<uchar> _indexPlane;     // phase 1 palette index per pixel, or all ones
+    int _indexBytes;
+    bool search2(QPoint, QRgb&, qint64&);
+    bool search3(QPoint, QRgb&, TriangleCache&, qint64&);
+    bool posJudge(QPoint);
+    void buildSpiral();
+    QVector<SpiralStep> _spiral;
+    QVector<int> _spiralRing;   // first step of every Chebyshev ring
+    int _spiralReach;
+    NeighborField _field;
+    QVector<int> unresolvedPixels();
+    QVector<int> resolvePixels(const QVector<int>&, ClassPlane::PixelClass, int);
+    inline const QRgb *originalLine(int x) const
+        {return reinterpret_cast<const QRgb*>(_original.constScanLine(x));}
+    inline QRgb *rasterLine(int x) {return _rasterBits + x * _rasterStride;}
+
+    // calculation related
+    void convertColorToVector(QRgb, double*);
+    void vectorMinus(double*, double*, double*);
+    double vectorDotProduct(double*);
+    double vectorDotProduct(double*, double*);
+
+    // shape color related
+    void coverShapeRows(int, int, uchar*, uchar*, const WindowBounds*);
+    void markShapeWindow(int, int, uchar*, int);
+    bool isUniformWindow(int, int, const WindowBounds*);
+
+    // main step
+    void prepareRaster();
+    void getShapeColor(QVector<uchar>*);
+    bool streamBands(BandReader&, BandWriter&);
+    void searchNearestColors();
+    void recolorization();
+    void countClasses(int, int);
+
+signals:
+    void processPercentage(int);
+    void statusUpdate(QString);
+    void statsReady(const RasterStats &);
+    void finished();
+
+public slots:
+    void raster();
+};
+
+#endif // RASTERHANDLER_H
@@ -0,0 +1,43 @@
+# Rasterization core shared by the GUI and the command line tools
+
+CONFIG += c++11
+
+# QAtomicInteger and the JSON stats need Qt 5.3
+lessThan(QT_MAJOR_VERSION, 5): QT_TOO_OLD = 1
+equals(QT_MAJOR_VERSION, 5): lessThan(QT_MINOR_VERSION, 3): QT_TOO_OLD = 1
+!isEmpty(QT_TOO_OLD): error("Qt 5.3 or newer is required")
+
+INCLUDEPATH += $$PWD
+
+# the streaming mode reads and writes PNG rows through libpng
+LIBS += -lpng
+
+SOURCES += $$PWD/rasterhandler.cpp \
+    $$PWD/parallel.cpp \
+    $$PWD/colorpalette.cpp \
+    $$PWD/windowbounds.cpp \
+    $$PWD/nearestcolor.cpp \
+    $$PWD/colorcache.cpp \
+    $$PWD/classplane.cpp \
+    $$PWD/neighborfield.cpp \
+    $$PWD/progressreporter.cpp \
+    $$PWD/bandio.cpp \
+    $$PWD/trianglecache.cpp \
+    $$PWD/rasterstats.cpp \
+    $$PWD/tracerecorder.cpp
+
+HEADERS += $$PWD/rasterhandler.h \
+    $$PWD/parallel.h \
+    $$PWD/colorpalette.h \
+    $$PWD/windowbounds.h \
+    $$PWD/nearestcolor.h \
+    $$PWD/colorcache.h \
+    $$PWD/classplane.h \
+    $$PWD/neighborfield.h \
+    $$PWD/progressreporter.h \
+    $$PWD/bandio.h \
+    $$PWD/colormath.h \
+    $$PWD/trianglecache.h \
+    $$PWD/hashtable.h \
+    $$PWD/rasterstats.h \
+    $$PWD/tracerecorder.h
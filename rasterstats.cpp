@@ -0,0 +1,49 @@
+#include "rasterstats.h"
+
+static const char *stageNames[RasterStats::Stages] =
+    {"load", "shape_color", "build_nearest", "nearest_search", "phase1", "phase2", "phase3", "save"};
+
+RasterStats::RasterStats() {clear();}
+
+void RasterStats::clear()
+{
+    for (int i = 0; i < Stages; i++)
+    {
+        nsecs[i] = 0;
+        reused[i] = false;
+    }
+    for (int i = 0; i <= ClassPlane::Phase3; i++) resolved[i] = 0;
+    paletteSize = 0;
+    pixels = nearestQueries = gridQueries = searchSteps = 0;
+}
+
+const char *RasterStats::stageName(Stage stage) {return stageNames[stage];}
+
+// Times are in milliseconds with microsecond resolution
+
+QJsonObject RasterStats::toJson() const
+{
+    QJsonObject stages, counts;
+    for (int i = 0; i < Stages; i++)
+    {
+        QJsonObject stage;
+        stage.insert(QString("ms"), nsecs[i] / 1e6);
+        if (reused[i]) stage.insert(QString("reused"), true);
+        stages.insert(QString(stageNames[i]), stage);
+    }
+
+    counts.insert(QString("palette_size"), paletteSize);
+    counts.insert(QString("pixels"), pixels);
+    counts.insert(QString("phase1_pixels"), resolved[ClassPlane::Phase1]);
+    counts.insert(QString("phase2_pixels"), resolved[ClassPlane::Phase2]);
+    counts.insert(QString("phase3_pixels"), resolved[ClassPlane::Phase3]);
+    counts.insert(QString("unresolved_pixels"), resolved[ClassPlane::Unresolved]);
+    counts.insert(QString("nearest_queries"), nearestQueries);
+    counts.insert(QString("grid_queries"), gridQueries);
+    counts.insert(QString("search_steps"), searchSteps);
+
+    QJsonObject stats;
+    stats.insert(QString("stages"), stages);
+    stats.insert(QString("counts"), counts);
+    return stats;
+}
@@ -0,0 +1,42 @@
+#ifndef RASTERSTATS_H
+#define RASTERSTATS_H
+
+#include <QtGlobal>
+#include <QMetaType>
+#include <QElapsedTimer>
+#include <QJsonObject>
+#include "classplane.h"
+
+// Wall time and work counts of the last raster() or rasterStream() run.
+// Stages that ran more than once (per band when streaming) add up, and
+// stages a cached result let raster() skip are flagged as reused. The load
+// time is kept from setOriginal() and the save time is added by
+// saveRastered(), after statsReady() has been emitted.
+
+struct RasterStats
+{
+    enum Stage {Load, ShapeColor, BuildNearest, NearestSearch, Phase1, Phase2, Phase3, Save, Stages};
+
+    qint64 nsecs[Stages];
+    bool reused[Stages];
+    int paletteSize;
+    qint64 pixels;
+    qint64 resolved[ClassPlane::Phase3 + 1];    // Unresolved is what phase 3 left
+    qint64 nearestQueries;                      // colors missing the cache
+    qint64 gridQueries;                         // the part of them searched in the color grid
+    qint64 searchSteps;                         // spiral positions visited by search()
+
+    RasterStats();
+    void clear();
+    inline void lap(Stage stage, QElapsedTimer &timer)
+    {
+        nsecs[stage] += timer.nsecsElapsed();
+        timer.start();
+    }
+    static const char *stageName(Stage);
+    QJsonObject toJson() const;
+};
+
+Q_DECLARE_METATYPE(RasterStats)
+
+#endif // RASTERSTATS_H
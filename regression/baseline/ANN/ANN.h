@@ -0,0 +1,59 @@
+#ifndef ANN_H
+#define ANN_H
+
+#include <cfloat>
+
+// Exact brute force stand-in for the part of ANN the baseline rasterizer
+// uses. ANN breaks ties between equally near points by its tree layout,
+// this resolves them to the lowest point index like the current nearest
+// color search, so the goldens don't depend on a libANN build.
+
+typedef double ANNcoord;
+typedef double ANNdist;
+typedef int ANNidx;
+typedef ANNcoord *ANNpoint;
+typedef ANNpoint *ANNpointArray;
+typedef ANNdist *ANNdistArray;
+typedef ANNidx *ANNidxArray;
+
+inline ANNpoint annAllocPt(int dim) {return new ANNcoord[dim];}
+
+inline ANNpointArray annAllocPts(int n, int dim)
+{
+    ANNpointArray pa = new ANNpoint[n];
+    ANNpoint p = new ANNcoord[n * dim];
+    for (int i = 0; i < n; i++) pa[i] = p + i * dim;
+    return pa;
+}
+
+inline void annClose() {}
+
+class ANNkd_tree
+{
+public:
+    ANNkd_tree(ANNpointArray pa, int n, int dd) : _pts(pa), _n(n), _dim(dd) {}
+
+    // k = 1 only, eps is ignored as the search is exact. An empty tree
+    // answers like ANN's, with a null index at infinite distance
+    void annkSearch(ANNpoint q, int, ANNidxArray nn_idx, ANNdistArray dd, double = 0.0)
+    {
+        nn_idx[0] = -1;
+        dd[0] = DBL_MAX;
+        for (int i = 0; i < _n; i++)
+        {
+            ANNdist dist = 0;
+            for (int d = 0; d < _dim; d++) dist += (q[d] - _pts[i][d]) * (q[d] - _pts[i][d]);
+            if (dist < dd[0])
+            {
+                nn_idx[0] = i;
+                dd[0] = dist;
+            }
+        }
+    }
+
+private:
+    ANNpointArray _pts;
+    int _n, _dim;
+};
+
+#endif // ANN_H
@@ -0,0 +1,33 @@
+#-------------------------------------------------
+#
+# Records the regression golden set with the baseline rasterizer
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = eciser_regression_baseline
+TEMPLATE = app
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+# rasterhandler.h/.cpp are the baseline ones, unchanged, built against the
+# exact ANN stand-in in ANN/. The synthetic images are shared with the
+# benchmark; 75.png and fits.png, whose phase 2 fits land on the fitting
+# threshold, are always part of the corpus
+INCLUDEPATH += $$PWD $$PWD/.. $$PWD/../../benchmark
+DEFINES += REGRESSION_SAMPLE=\\\"$$PWD/../../75.png\\\" \
+    REGRESSION_FITS=\\\"$$PWD/../fits.png\\\"
+
+SOURCES += main.cpp \
+    baselinerunner.cpp \
+    rasterhandler.cpp \
+    ../regressionrunner.cpp \
+    ../../benchmark/imagegenerator.cpp
+
+HEADERS  += baselinerunner.h \
+    rasterhandler.h \
+    ANN/ANN.h \
+    ../regressionrunner.h \
+    ../../benchmark/imagegenerator.h
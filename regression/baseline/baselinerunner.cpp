@@ -0,0 +1,46 @@
+#include "baselinerunner.h"
+#include <QFile>
+#include <QStringList>
+
+BaselineRunner::BaselineRunner(const QDir &golden, QTextStream *log) :
+    RegressionRunner(golden, log), _cwd(QDir::currentPath())
+{
+    _r.setDebugON();
+    QDir::setCurrent(_scratch.path());
+}
+
+BaselineRunner::~BaselineRunner()
+{
+    QDir::setCurrent(_cwd);
+}
+
+bool BaselineRunner::rasterCase(const QImage &image, const RegressionParameters &p,
+                                QImage &rastered, QImage &classes)
+{
+    QString source = _scratch.path() + QString("/source.png");
+    if (!image.save(source)) return false;
+
+    _r.setWindow(p.window);
+    _r.setColorThreshold(p.cthres);
+    _r.setFittingColorThreshold(p.fcthres);
+    _r.setSearchDiameter(p.sdiam);
+    _r.setOriginal(source);
+    if (!_r.isLoaded()) return false;
+    _r.raster();
+    if (!_r.isRastered()) return false;
+    rastered = _r.getRastered();
+
+    // found.map holds a '0' to '3' class and a space per pixel, a row per line
+    QFile map(_scratch.path() + QString("/found.map"));
+    if (!map.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+    QTextStream in(&map);
+    classes = classImage(rastered.width(), rastered.height());
+    for (int x = 0; x < classes.height(); x++)
+    {
+        QString line = in.readLine();
+        if (line.size() != 2 * classes.width()) return false;
+        uchar *classLine = classes.scanLine(x);
+        for (int y = 0; y < classes.width(); y++) classLine[y] = line.at(2 * y).toLatin1() - '0';
+    }
+    return true;
+}
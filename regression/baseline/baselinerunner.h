@@ -0,0 +1,29 @@
+#ifndef BASELINERUNNER_H
+#define BASELINERUNNER_H
+
+#include "regressionrunner.h"
+#include "rasterhandler.h"
+
+// Runs the cases through the baseline RasterHandler. It loads from files
+// and has no thread count, so every case goes through a scratch PNG; its
+// pixel classes only come out as the found.map debug file, which it writes
+// to the working directory. The runner works in its scratch directory for
+// as long as it lives.
+
+class BaselineRunner : public RegressionRunner
+{
+public:
+    BaselineRunner(const QDir &golden, QTextStream *log);
+    ~BaselineRunner();
+
+protected:
+    bool rasterCase(const QImage &, const RegressionParameters &, QImage &, QImage &);
+
+private:
+    // one handler for every case, each baseline handler allocates room for
+    // MAX_COLORS ANN points and never frees it
+    RasterHandler _r;
+    QString _cwd;
+};
+
+#endif // BASELINERUNNER_H
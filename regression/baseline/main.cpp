@@ -0,0 +1,132 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QStringList>
+#include <QFileInfo>
+#include <QVector>
+#include "imagegenerator.h"
+#include "baselinerunner.h"
+
+// Parses a comma separated list of positive numbers
+
+static bool parseList(const QString &value, QVector<double> &list)
+{
+    QStringList items = value.split(QChar(','));
+    list.clear();
+    for (int i = 0; i < items.size(); i++)
+    {
+        bool ok;
+        double n = items.at(i).toDouble(&ok);
+        if (!ok || n <= 0) return false;
+        list.append(n);
+    }
+    return !list.isEmpty();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("eciser_regression_baseline");
+
+    QTextStream out(stdout), err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Records the golden set of the baseline rasterization.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("golden", "Directory of the golden set.");
+    parser.addPositionalArgument("images", "Extra images added to the corpus.", "[images...]");
+
+    QCommandLineOption kindsOption(QStringList() << "k" << "kinds",
+                                   "Generated image kinds: flat, antialiased, gradient, noise.",
+                                   "list", "flat,antialiased,gradient,noise");
+    QCommandLineOption sizesOption(QStringList() << "s" << "sizes",
+                                   "Generated image sizes.", "list", "48,131");
+    QCommandLineOption colorsOption(QStringList() << "c" << "colors",
+                                    "Generated source palette sizes.", "list", "4,24");
+    QCommandLineOption seedOption("seed", "Image generator seed.", "value", "1");
+    QCommandLineOption windowOption(QStringList() << "w" << "windows",
+                                    "Shape color window sizes.", "list", "2,3,5");
+    QCommandLineOption cthresOption(QStringList() << "t" << "color-thresholds",
+                                    "Shape color thresholds.", "list", "1,6");
+    QCommandLineOption fcthresOption(QStringList() << "f" << "fitting-thresholds",
+                                     "Fitting color thresholds.", "list", "3,12");
+    QCommandLineOption sdiamOption(QStringList() << "d" << "search-diameters",
+                                   "Search diameters.", "list", "3,7,12");
+    parser.addOption(kindsOption);
+    parser.addOption(sizesOption);
+    parser.addOption(colorsOption);
+    parser.addOption(seedOption);
+    parser.addOption(windowOption);
+    parser.addOption(cthresOption);
+    parser.addOption(fcthresOption);
+    parser.addOption(sdiamOption);
+    parser.process(a);
+
+    QStringList args = parser.positionalArguments();
+    if (args.size() < 1)
+    {
+        err << "Expected a golden directory." << endl;
+        return 1;
+    }
+
+    QVector<double> sizes, colors, windows, cthres, fcthres, sdiams;
+    bool ok[7];
+    ok[0] = parseList(parser.value(sizesOption), sizes);
+    ok[1] = parseList(parser.value(colorsOption), colors);
+    ok[2] = parseList(parser.value(windowOption), windows);
+    ok[3] = parseList(parser.value(cthresOption), cthres);
+    ok[4] = parseList(parser.value(fcthresOption), fcthres);
+    ok[5] = parseList(parser.value(sdiamOption), sdiams);
+    quint32 seed = parser.value(seedOption).toUInt(&ok[6]);
+    if (!ok[0] || !ok[1] || !ok[2] || !ok[3] || !ok[4] || !ok[5] || !ok[6])
+    {
+        err << "Invalid parameter." << endl;
+        return 1;
+    }
+
+    // the runner moves to its scratch directory, paths are resolved first
+    QStringList images = args.mid(1);
+    for (int i = 0; i < images.size(); i++) images[i] = QFileInfo(images.at(i)).absoluteFilePath();
+    BaselineRunner runner(QDir(QDir(args.at(0)).absolutePath()), &out);
+
+    QStringList kindNames = parser.value(kindsOption).split(QChar(','));
+    for (int k = 0; k < kindNames.size(); k++)
+    {
+        ImageKind kind;
+        if (!parseImageKind(kindNames.at(k), kind))
+        {
+            err << "Unknown image kind " << kindNames.at(k) << endl;
+            return 1;
+        }
+        for (int s = 0; s < sizes.size(); s++)
+            for (int c = 0; c < colors.size(); c++)
+                runner.addImage(imageKindName(kind) + QString("_") + QString::number(sizes.at(s)) +
+                                QString("_") + QString::number(colors.at(c)),
+                                generateImage(kind, sizes.at(s), sizes.at(s), colors.at(c), seed));
+    }
+
+    images.prepend(QString(REGRESSION_FITS));
+    images.prepend(QString(REGRESSION_SAMPLE));
+    for (int i = 0; i < images.size(); i++)
+    {
+        QImage image(images.at(i));
+        if (image.isNull())
+        {
+            err << "Cannot load " << images.at(i) << endl;
+            return 1;
+        }
+        runner.addImage(QFileInfo(images.at(i)).completeBaseName(), image);
+    }
+
+    for (int w = 0; w < windows.size(); w++)
+        for (int t = 0; t < cthres.size(); t++)
+            for (int f = 0; f < fcthres.size(); f++)
+                for (int d = 0; d < sdiams.size(); d++)
+                {
+                    RegressionParameters p = {(int)windows.at(w), (int)sdiams.at(d),
+                                              cthres.at(t), fcthres.at(f)};
+                    runner.addParameters(p);
+                }
+
+    return runner.record() == 0 ? 0 : 1;
+}
@@ -0,0 +1,31 @@
+#include "currentrunner.h"
+#include "rasterhandler.h"
+
+CurrentRunner::CurrentRunner(const QDir &golden, int threads, QTextStream *log) :
+    RegressionRunner(golden, log), _threads(threads) {}
+
+bool CurrentRunner::rasterCase(const QImage &image, const RegressionParameters &p,
+                               QImage &rastered, QImage &classes)
+{
+    // RasterHandler only loads from files, the source goes through a
+    // scratch PNG like it does for the baseline
+    QString source = _scratch.path() + QString("/source.png");
+    if (!image.save(source)) return false;
+
+    RasterHandler r(p.window, p.cthres, p.sdiam, p.fcthres);
+    r.setThreadCount(_threads);
+    r.setOriginal(source);
+    if (!r.isLoaded()) return false;
+    r.raster();
+    if (!r.isRastered()) return false;
+
+    rastered = r.getRastered();
+    classes = classImage(rastered.width(), rastered.height());
+    const ClassPlane &found = r.getPixelClasses();
+    for (int x = 0; x < classes.height(); x++)
+    {
+        uchar *line = classes.scanLine(x);
+        for (int y = 0; y < classes.width(); y++) line[y] = found.at(x * classes.width() + y);
+    }
+    return true;
+}
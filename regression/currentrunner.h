@@ -0,0 +1,20 @@
+#ifndef CURRENTRUNNER_H
+#define CURRENTRUNNER_H
+
+#include "regressionrunner.h"
+
+// Runs the cases through the current RasterHandler with `threads` threads
+
+class CurrentRunner : public RegressionRunner
+{
+public:
+    CurrentRunner(const QDir &golden, int threads, QTextStream *log);
+
+protected:
+    bool rasterCase(const QImage &, const RegressionParameters &, QImage &, QImage &);
+
+private:
+    int _threads;
+};
+
+#endif // CURRENTRUNNER_H
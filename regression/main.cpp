@@ -0,0 +1,44 @@
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+#include <QStringList>
+#include <QThread>
+#include "currentrunner.h"
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+    QCoreApplication::setApplicationName("eciser_regression");
+
+    QTextStream out(stdout), err(stderr);
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Checks the rasterization against golden outputs "
+                                     "recorded from the baseline pipeline.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("golden", "Directory of the golden set.");
+
+    QCommandLineOption threadsOption(QStringList() << "p" << "threads",
+                                     "Threads used by the rasterization.", "count",
+                                     QString::number(QThread::idealThreadCount()));
+    parser.addOption(threadsOption);
+    parser.process(a);
+
+    QStringList args = parser.positionalArguments();
+    if (args.size() != 1)
+    {
+        err << "Expected a golden directory." << endl;
+        return 1;
+    }
+
+    bool ok;
+    int threads = parser.value(threadsOption).toInt(&ok);
+    if (!ok || threads < 1)
+    {
+        err << "Invalid parameter." << endl;
+        return 1;
+    }
+
+    CurrentRunner runner(QDir(args.at(0)), threads, &out);
+    return runner.compare() == 0 ? 0 : 1;
+}
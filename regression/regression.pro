@@ -0,0 +1,23 @@
+#-------------------------------------------------
+#
+# Golden output regression check of the rasterization core
+#
+#-------------------------------------------------
+
+QT       += core gui
+
+TARGET = eciser_regression
+TEMPLATE = app
+
+CONFIG   += console
+CONFIG   -= app_bundle
+
+include(../rasterhandler.pri)
+
+# the golden set is recorded by baseline/baseline.pro
+SOURCES += main.cpp \
+    regressionrunner.cpp \
+    currentrunner.cpp
+
+HEADERS  += regressionrunner.h \
+    currentrunner.h
@@ -0,0 +1,225 @@
+#include "regressionrunner.h"
+#include <QFile>
+#include <QStringList>
+
+RegressionRunner::RegressionRunner(const QDir &golden, QTextStream *log) :
+    _golden(golden), _log(log) {}
+
+RegressionRunner::~RegressionRunner() {}
+
+// Both pipelines see the same 32-bit source whatever format the image came in
+
+void RegressionRunner::addImage(const QString &name, const QImage &image)
+{
+    RegressionImage entry = {name, image.convertToFormat(image.hasAlphaChannel() ?
+                                                         QImage::Format_ARGB32 :
+                                                         QImage::Format_RGB32)};
+    _images.append(entry);
+}
+
+void RegressionRunner::addParameters(const RegressionParameters &parameters)
+{
+    _parameters.append(parameters);
+}
+
+QString RegressionRunner::caseName(const RegressionImage &image,
+                                   const RegressionParameters &p) const
+{
+    return image.name + QString("_w") + QString::number(p.window) +
+           QString("_t") + QString::number(p.cthres) +
+           QString("_f") + QString::number(p.fcthres) +
+           QString("_d") + QString::number(p.sdiam);
+}
+
+QImage RegressionRunner::classImage(int width, int height)
+{
+    QImage classes(width, height, QImage::Format_Indexed8);
+    QVector<QRgb> table;
+    for (int c = 0; c < 4; c++) table.append(qRgb(c * 85, c * 85, c * 85));
+    classes.setColorTable(table);
+    return classes;
+}
+
+int RegressionRunner::record()
+{
+    int failed = 0;
+    QFile manifest(_golden.filePath(QString("manifest.txt")));
+    if (!_golden.mkpath(QString("images")) || !manifest.open(QIODevice::WriteOnly | QIODevice::Text))
+        return -1;
+    QTextStream cases(&manifest);
+
+    for (int i = 0; i < _images.size(); i++)
+    {
+        if (!_images.at(i).image.save(_golden.filePath(QString("images/") + _images.at(i).name +
+                                                       QString(".png"))))
+            return -1;
+        for (int j = 0; j < _parameters.size(); j++)
+        {
+            const RegressionParameters &p = _parameters.at(j);
+            QString name = caseName(_images.at(i), p);
+            QImage rastered, classes;
+            if (!rasterCase(_images.at(i).image, p, rastered, classes) ||
+                    !rastered.save(_golden.filePath(name + QString(".png"))) ||
+                    !classes.save(_golden.filePath(name + QString("_found.png"))))
+            {
+                *_log << name << ": failed" << endl;
+                failed++;
+                continue;
+            }
+            cases << name << ' ' << _images.at(i).name << ' ' << p.window << ' ' << p.cthres
+                  << ' ' << p.fcthres << ' ' << p.sdiam << endl;
+        }
+    }
+    *_log << _images.size() * _parameters.size() - failed << " cases recorded in "
+          << _golden.path() << endl;
+    return failed;
+}
+
+bool RegressionRunner::readManifest(QVector<Case> &cases)
+{
+    QFile file(_golden.filePath(QString("manifest.txt")));
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        QStringList fields = in.readLine().trimmed().split(QChar(' '));
+        if (fields.size() == 1 && fields.at(0).isEmpty()) continue;
+        bool ok[4];
+        Case c;
+        if (fields.size() != 6) return false;
+        c.name = fields.at(0);
+        c.image = fields.at(1);
+        c.parameters.window = fields.at(2).toInt(&ok[0]);
+        c.parameters.cthres = fields.at(3).toDouble(&ok[1]);
+        c.parameters.fcthres = fields.at(4).toDouble(&ok[2]);
+        c.parameters.sdiam = fields.at(5).toInt(&ok[3]);
+        if (!ok[0] || !ok[1] || !ok[2] || !ok[3]) return false;
+        cases.append(c);
+    }
+    return true;
+}
+
+bool RegressionRunner::readExpected(QHash<QString, Mismatch> &expected)
+{
+    QFile file(_golden.filePath(QString("expected.txt")));
+    if (!file.exists()) return true;
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) return false;
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        QString line = in.readLine();
+        int comment = line.indexOf(QString("#"));
+        if (comment >= 0) line = line.left(comment);
+        line = line.trimmed();
+        if (line.isEmpty()) continue;
+
+        QStringList fields = line.split(QChar(' '));
+        bool ok[2];
+        Mismatch m;
+        if (fields.size() != 3) return false;
+        m.colors = fields.at(1).toInt(&ok[0]);
+        m.classes = fields.at(2).toInt(&ok[1]);
+        if (!ok[0] || !ok[1]) return false;
+        expected.insert(fields.at(0), m);
+    }
+    return true;
+}
+
+bool RegressionRunner::compareCase(const Case &c, const QImage &source, Mismatch &mismatch)
+{
+    QImage rastered, classes;
+    QImage goldenRastered(_golden.filePath(c.name + QString(".png")));
+    QImage goldenClasses(_golden.filePath(c.name + QString("_found.png")));
+    if (goldenRastered.isNull() || goldenClasses.format() != QImage::Format_Indexed8)
+    {
+        *_log << c.name << ": no golden output" << endl;
+        return false;
+    }
+    if (!rasterCase(source, c.parameters, rastered, classes))
+    {
+        *_log << c.name << ": rasterization failed" << endl;
+        return false;
+    }
+    goldenRastered = goldenRastered.convertToFormat(QImage::Format_ARGB32);
+    rastered = rastered.convertToFormat(QImage::Format_ARGB32);
+    if (goldenRastered.size() != rastered.size() || goldenClasses.size() != classes.size())
+    {
+        *_log << c.name << ": size differs" << endl;
+        return false;
+    }
+
+    mismatch.colors = mismatch.classes = 0;
+    for (int x = 0; x < rastered.height(); x++)
+    {
+        const QRgb *a = reinterpret_cast<const QRgb*>(rastered.constScanLine(x));
+        const QRgb *b = reinterpret_cast<const QRgb*>(goldenRastered.constScanLine(x));
+        const uchar *ca = classes.constScanLine(x), *cb = goldenClasses.constScanLine(x);
+        for (int y = 0; y < rastered.width(); y++)
+        {
+            mismatch.colors += a[y] != b[y];
+            mismatch.classes += ca[y] != cb[y];
+        }
+    }
+    return true;
+}
+
+int RegressionRunner::compare()
+{
+    QVector<Case> cases;
+    QHash<QString, Mismatch> expected;
+    if (!readManifest(cases))
+    {
+        *_log << "Cannot read the manifest of " << _golden.path() << endl;
+        return -1;
+    }
+    if (!readExpected(expected))
+    {
+        *_log << "Cannot read the expected differences of " << _golden.path() << endl;
+        return -1;
+    }
+
+    int failed = 0, differing = 0, listed = 0;
+    QHash<QString, QImage> sources;
+    for (int i = 0; i < cases.size(); i++)
+    {
+        const Case &c = cases.at(i);
+        if (!sources.contains(c.image))
+            sources.insert(c.image, QImage(_golden.filePath(QString("images/") + c.image +
+                                                            QString(".png"))));
+        Mismatch m;
+        if (sources.value(c.image).isNull())
+        {
+            *_log << c.name << ": cannot load " << c.image << endl;
+            failed++;
+            continue;
+        }
+        if (!compareCase(c, sources.value(c.image), m))
+        {
+            failed++;
+            continue;
+        }
+
+        bool isListed = expected.contains(c.name);
+        Mismatch e = expected.value(c.name);
+        listed += isListed;
+        if (!m.colors && !m.classes && !isListed) continue;
+        if (isListed && m.colors == e.colors && m.classes == e.classes)
+        {
+            differing++;
+            continue;
+        }
+        *_log << c.name << ": " << m.colors << " colors and " << m.classes << " classes differ";
+        if (isListed) *_log << ", expected " << e.colors << " and " << e.classes;
+        *_log << endl;
+        failed++;
+    }
+    if (listed != expected.size())
+    {
+        *_log << expected.size() - listed << " expected differences name no case" << endl;
+        failed++;
+    }
+
+    *_log << cases.size() - failed << " of " << cases.size() << " cases pass, "
+          << differing << " of them with their expected differences" << endl;
+    return failed;
+}
@@ -0,0 +1,80 @@
+#ifndef REGRESSIONRUNNER_H
+#define REGRESSIONRUNNER_H
+
+#include <QtGui/QImage>
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QDir>
+#include <QTextStream>
+#include <QTemporaryDir>
+
+struct RegressionImage
+{
+    QString name;
+    QImage image;
+};
+
+struct RegressionParameters
+{
+    int window, sdiam;
+    double cthres, fcthres;
+};
+
+// A golden set is a directory holding
+//
+//  images/<image>.png  the corpus, as 32-bit RGB or ARGB images
+//  manifest.txt        one case per line: name, image, window, color
+//                      threshold, fitting threshold and search diameter
+//  <case>.png          the rastered image of every case
+//  <case>_found.png    its pixel class map, an indexed image whose indices
+//                      are the ClassPlane classes
+//  expected.txt        the differences the current pipeline is known to
+//                      have, one case per line with its color and class
+//                      mismatch counts; # starts a comment
+//
+// record() writes everything but expected.txt from the cases added to the
+// runner. compare() ignores them and reruns the manifest, a case passes
+// when it matches pixel for pixel or differs exactly as expected.txt says.
+// Subclasses plug in the rasterization pipeline under test.
+
+class RegressionRunner
+{
+public:
+    RegressionRunner(const QDir &golden, QTextStream *log);
+    virtual ~RegressionRunner();
+    void addImage(const QString &name, const QImage &);
+    void addParameters(const RegressionParameters &);
+    int record();
+    int compare();
+
+protected:
+    virtual bool rasterCase(const QImage &, const RegressionParameters &,
+                            QImage &rastered, QImage &classes) = 0;
+    static QImage classImage(int width, int height);
+
+    QDir _golden;
+    QTextStream *_log;
+    QTemporaryDir _scratch;     // files the pipelines load and write on the way
+
+private:
+    struct Case
+    {
+        QString name, image;
+        RegressionParameters parameters;
+    };
+    struct Mismatch
+    {
+        int colors, classes;
+    };
+
+    QString caseName(const RegressionImage &, const RegressionParameters &) const;
+    bool readManifest(QVector<Case> &);
+    bool readExpected(QHash<QString, Mismatch> &);
+    bool compareCase(const Case &, const QImage &source, Mismatch &);
+
+    QVector<RegressionImage> _images;
+    QVector<RegressionParameters> _parameters;
+};
+
+#endif // REGRESSIONRUNNER_H
@@ -0,0 +1,80 @@
+#include "tracerecorder.h"
+#include <QThread>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonDocument>
+
+TraceRecorder::TraceRecorder() {_clock.start();}
+
+void TraceRecorder::begin(const char *name, int index, const QString &detail)
+{
+    record(name, 'B', index, detail);
+}
+
+void TraceRecorder::end(const char *name) {record(name, 'E', -1, QString());}
+
+void TraceRecorder::record(const char *name, char phase, int index, const QString &detail)
+{
+    Event event = {name, phase, 0, index, 0, detail};
+    quintptr thread = quintptr(QThread::currentThreadId());
+    QMutexLocker locker(&_lock);
+    event.nsecs = _clock.nsecsElapsed();
+    event.tid = _threads.value(thread, -1);
+    if (event.tid < 0)
+    {
+        event.tid = _threads.size() + 1;
+        _threads.insert(thread, event.tid);
+    }
+    _events.append(event);
+}
+
+// Drops the recorded events, thread ids and timestamps keep counting
+
+void TraceRecorder::clear()
+{
+    QMutexLocker locker(&_lock);
+    _events.clear();
+}
+
+// Timestamps are in microseconds since the recorder was created
+
+bool TraceRecorder::save(const QString &path)
+{
+    QJsonArray events;
+    QMutexLocker locker(&_lock);
+    for (int i = 0; i < _events.size(); i++)
+    {
+        const Event &e = _events.at(i);
+        QJsonObject event, args;
+        event.insert(QString("name"), QString(e.name));
+        event.insert(QString("cat"), QString("raster"));
+        event.insert(QString("ph"), QString(QChar(e.phase)));
+        event.insert(QString("ts"), e.nsecs / 1e3);
+        event.insert(QString("pid"), 1);
+        event.insert(QString("tid"), e.tid);
+        if (e.index >= 0) args.insert(QString("index"), e.index);
+        if (!e.detail.isEmpty()) args.insert(QString("detail"), e.detail);
+        if (e.index >= 0 || !e.detail.isEmpty()) event.insert(QString("args"), args);
+        events.append(event);
+    }
+    for (int tid = 1; tid <= _threads.size(); tid++)
+    {
+        QJsonObject event, args;
+        args.insert(QString("name"), QString("thread ") + QString::number(tid));
+        event.insert(QString("name"), QString("thread_name"));
+        event.insert(QString("ph"), QString("M"));
+        event.insert(QString("pid"), 1);
+        event.insert(QString("tid"), tid);
+        event.insert(QString("args"), args);
+        events.append(event);
+    }
+    locker.unlock();
+
+    QJsonObject trace;
+    trace.insert(QString("traceEvents"), events);
+    trace.insert(QString("displayTimeUnit"), QString("ms"));
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) return false;
+    return file.write(QJsonDocument(trace).toJson(QJsonDocument::Compact)) >= 0;
+}
@@ -0,0 +1,69 @@
+#ifndef TRACERECORDER_H
+#define TRACERECORDER_H
+
+#include <QString>
+#include <QVector>
+#include <QHash>
+#include <QMutex>
+#include <QElapsedTimer>
+
+// Collects begin/end events of the rasterization stages and of the bands
+// and chunks their workers pick up, and writes them as a Chrome trace JSON
+// file (chrome://tracing, ui.perfetto.dev). Events are kept in memory until
+// save(); a recorder can be shared by handlers running in several threads.
+//
+// Handlers hold a null recorder unless tracing is on, the helpers below
+// make every trace point a single branch then.
+
+class TraceRecorder
+{
+public:
+    TraceRecorder();
+    void begin(const char *name, int index = -1, const QString &detail = QString());
+    void end(const char *name);
+    bool save(const QString &path);
+    void clear();
+
+private:
+    struct Event
+    {
+        const char *name;
+        char phase;
+        int tid, index;
+        qint64 nsecs;
+        QString detail;
+    };
+    void record(const char *name, char phase, int index, const QString &detail);
+
+    QMutex _lock;
+    QElapsedTimer _clock;
+    QVector<Event> _events;
+    QHash<quintptr, int> _threads;  // small ids in order of the first event
+};
+
+inline void traceBegin(TraceRecorder *trace, const char *name, int index = -1)
+{
+    if (trace) trace->begin(name, index);
+}
+
+inline void traceEnd(TraceRecorder *trace, const char *name)
+{
+    if (trace) trace->end(name);
+}
+
+// Scoped begin/end pair, index is the band or chunk number when >= 0
+
+class TraceScope
+{
+public:
+    inline TraceScope(TraceRecorder *trace, const char *name, int index = -1) :
+        _trace(trace), _name(name) {traceBegin(_trace, _name, index);}
+    inline ~TraceScope() {traceEnd(_trace, _name);}
+
+private:
+    Q_DISABLE_COPY(TraceScope)
+    TraceRecorder *_trace;
+    const char *_name;
+};
+
+#endif // TRACERECORDER_H
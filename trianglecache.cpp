@@ -0,0 +1,34 @@
+#include "trianglecache.h"
+#include "colormath.h"
+
+#define CACHE_MIN_BITS 8
+
+TriangleCache::TriangleCache() : _table(CACHE_MIN_BITS)
+{
+    _hits = _misses = 0;
+}
+
+void TriangleCache::clear()
+{
+    _table.clear();
+}
+
+TriangleCache::Triangle TriangleCache::lookup(int a, int b, int c, QRgb ca, QRgb cb, QRgb cc)
+{
+    TriangleKey key = {a + 1, b + 1, c + 1};
+    const Triangle *cached = _table.find(key);
+    if (cached)
+    {
+        _hits++;
+        return *cached;
+    }
+    _misses++;
+
+    if (_table.size() == TRIANGLE_CACHE_MAX) clear();
+    Triangle &t = _table.insert(key);
+    t.c00 = colorDot(cc, ca, cc, ca);
+    t.c01 = colorDot(cc, ca, cc, cb);
+    t.c11 = colorDot(cc, cb, cc, cb);
+    t.det = t.c01 * t.c01 - t.c00 * t.c11;
+    return t;
+}
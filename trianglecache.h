@@ -0,0 +1,47 @@
+#ifndef TRIANGLECACHE_H
+#define TRIANGLECACHE_H
+
+#include <QtGui/QColor>
+#include "hashtable.h"
+
+// Memoizes the geometry phase 3 derives from an ordered triple of palette
+// colors (a, b, c): the Gram matrix of the edges ac and bc and its
+// determinant, exact in integers. Dropped once it reaches
+// TRIANGLE_CACHE_MAX entries.
+
+#define TRIANGLE_CACHE_MAX (1 << 16)
+
+struct TriangleKey
+{
+    qint32 a, b, c;             // palette indices + 1, 0 when unused
+
+    inline bool operator==(const TriangleKey &o) const {return a == o.a && b == o.b && c == o.c;}
+};
+
+inline quint32 hashKey(const TriangleKey &key)
+{
+    return (key.a * 2654435761u) ^ (key.b * 2246822519u) ^ (key.c * 3266489917u);
+}
+
+class TriangleCache
+{
+public:
+    struct Triangle
+    {
+        qint64 c00, c01, c11;   // ac.ac, ac.bc, bc.bc
+        qint64 det;             // c01 * c01 - c00 * c11
+    };
+
+    TriangleCache();
+    void clear();
+    Triangle lookup(int a, int b, int c, QRgb ca, QRgb cb, QRgb cc);
+
+    qint64 hits() const {return _hits;}
+    qint64 misses() const {return _misses;}
+
+private:
+    HashTable<TriangleKey, Triangle> _table;
+    qint64 _hits, _misses;
+};
+
+#endif // TRIANGLECACHE_H
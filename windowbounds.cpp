@@ -0,0 +1,68 @@
+#include "windowbounds.h"
+
+// Sliding minimum (or maximum) over windows of `w` values taken `step` apart,
+// written `outStep` apart for the first `count` window positions. `deque`
+// needs room for count + w - 1 indices.
+
+template <bool Max>
+static void slidingExtreme(const uchar *in, int step, int w, int count,
+                           uchar *out, int outStep, int *deque)
+{
+    int head = 0, tail = 0;
+    for (int i = 0; i < count + w - 1; i++)
+    {
+        uchar v = in[i * step];
+        while (tail > head && (Max ? in[deque[tail-1] * step] <= v
+                                   : in[deque[tail-1] * step] >= v))
+            tail--;
+        deque[tail++] = i;
+        if (i < w - 1) continue;
+        while (deque[head] <= i - w) head++;
+        out[(i - w + 1) * outStep] = in[deque[head] * step];
+    }
+}
+
+WindowBounds::WindowBounds() : _from(0), _cols(0) {}
+
+void WindowBounds::compute(const QImage &image, int window, int from, int to, int cols)
+{
+    int rows = to - from;
+    int spanRows = rows + window - 1, spanCols = cols + window - 1;
+    QVector<int> deque(qMax(spanRows, spanCols));
+    QVector<uchar> line(3 * spanCols);
+    QVector<uchar> rowLo(3 * spanRows * cols), rowHi(3 * spanRows * cols);
+
+    _from = from;
+    _cols = cols;
+    _lo.resize(3 * rows * cols);
+    _hi.resize(3 * rows * cols);
+
+    // along the rows
+    for (int x = 0; x < spanRows; x++)
+    {
+        const QRgb *pixels = reinterpret_cast<const QRgb*>(image.constScanLine(from + x));
+        for (int y = 0; y < spanCols; y++)
+        {
+            QRgb p = pixels[y];
+            line[y] = qRed(p);
+            line[spanCols + y] = qGreen(p);
+            line[2 * spanCols + y] = qBlue(p);
+        }
+        for (int c = 0; c < 3; c++)
+        {
+            slidingExtreme<false>(line.constData() + c * spanCols, 1, window, cols,
+                                  rowLo.data() + 3 * x * cols + c, 3, deque.data());
+            slidingExtreme<true>(line.constData() + c * spanCols, 1, window, cols,
+                                 rowHi.data() + 3 * x * cols + c, 3, deque.data());
+        }
+    }
+
+    // then along the columns of the row results
+    for (int y = 0; y < cols; y++) for (int c = 0; c < 3; c++)
+    {
+        slidingExtreme<false>(rowLo.constData() + 3 * y + c, 3 * cols, window, rows,
+                              _lo.data() + 3 * y + c, 3 * cols, deque.data());
+        slidingExtreme<true>(rowHi.constData() + 3 * y + c, 3 * cols, window, rows,
+                             _hi.data() + 3 * y + c, 3 * cols, deque.data());
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef WINDOWBOUNDS_H
+#define WINDOWBOUNDS_H
+
+#include <QtGui/QImage>
+#include <QVector>
+
+// Per-channel minimum and maximum of every window x window block whose top
+// left corner lies in rows [from, to) and columns [0, cols) of an image,
+// computed with monotonic deques along rows and then along columns, so the
+// whole band costs O(pixels) independent of the window size.
+//
+// For a seed color inside the block this bounds the largest squared
+// distance between the seed and any pixel of the block from both sides:
+// `upper` is reached only if one pixel holds every channel extreme, `lower`
+// is reached by the pixel holding the farthest single channel extreme.
+// The image must be in one of the 32-bit RGB formats.
+
+class WindowBounds
+{
+public:
+    WindowBounds();
+    void compute(const QImage &, int window, int from, int to, int cols);
+
+    inline void distanceBounds(int x, int y, QRgb seed, int &lower, int &upper) const
+    {
+        int i = 3 * ((x - _from) * _cols + y);
+        int s[3] = {qRed(seed), qGreen(seed), qBlue(seed)};
+        lower = upper = 0;
+        for (int c = 0; c < 3; c++)
+        {
+            int below = s[c] - _lo.at(i + c), above = _hi.at(i + c) - s[c];
+            int d = below > above ? below : above;
+            upper += d * d;
+            if (d * d > lower) lower = d * d;
+        }
+    }
+
+private:
+    int _from, _cols;
+    QVector<uchar> _lo, _hi;    // interleaved r, g, b per window position
+};
+
+#endif // WINDOWBOUNDS_H